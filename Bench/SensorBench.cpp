@@ -0,0 +1,321 @@
+//
+//  SensorBench.cpp
+//  SMCProcessorAMD
+//
+//  Host timings of the sampling paths and of the SMC key reads, for 8, 32 and 128
+//  cores. Builds the real SMCProcessorAMDSensors.cpp and Keyimplementations.cpp
+//  against the kernel shims in Shim/, with the MSRs and the SMN index/data pair
+//  simulated below, and writes ns per call and calls per second of each path as JSON.
+//
+//  usage: SensorBench [out.json]
+//
+
+#include "SMCProcessorAMD.hpp"
+#include "SensorDecode.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+
+static constexpr size_t CoreCounts[] = {8, 32, 128};
+static constexpr size_t CoresPerCcd = 8;
+static constexpr size_t CoresPerPackage = 64;
+static constexpr unsigned Runs = 7;
+static constexpr unsigned CallsPerRun = 20000;
+static constexpr unsigned PollHz = 20;
+
+static constexpr uint32_t MsrPwrUnit = 0xC0010299;
+static constexpr uint32_t MsrCoreEnergy = 0xC001029A;
+static constexpr uint32_t MsrPkgEnergy = 0xC001029B;
+static constexpr uint32_t MsrPstateStatus = 0xC0010293;
+static constexpr uint8_t SmnIndex = 0x60;
+static constexpr uint8_t SmnData = 0x64;
+
+static volatile uint32_t sinkWord;
+
+
+/**
+ *  The kext translation unit is not part of the host build, these give the
+ *  provider a vtable.
+ */
+bool SMCProcessorAMD::init(OSDictionary *dictionary) { return true; }
+void SMCProcessorAMD::free(void) {}
+bool SMCProcessorAMD::start(IOService *provider) { return true; }
+void SMCProcessorAMD::stop(IOService *provider) {}
+
+
+namespace {
+    /**
+     *  Registers of the simulated machine. Energy counters advance on every read
+     *  and the core clocks are noisy, so no path reads constants.
+     */
+    struct SimulatedHardware {
+        uint32_t cpu {0};
+        uint32_t cpus {0};
+        std::vector<uint64_t> pstate;
+        std::vector<uint32_t> coreEnergy;
+        uint32_t packageEnergy {0xfffff000};
+        uint32_t smnIndex {0};
+        std::unordered_map<uint32_t, uint32_t> smn;
+        uint32_t seed {0x2545f491};
+
+        uint32_t next() {
+            seed = seed * 1664525u + 1013904223u;
+            return seed;
+        }
+
+        void reset(size_t cores) {
+            cpus = (uint32_t)cores;
+            pstate.resize(cores);
+            coreEnergy.resize(cores);
+            for (size_t i = 0; i < cores; i++) {
+                pstate[i] = ((uint64_t)(8 + next() % 4) << 8) | (0x70 + next() % 0x40);
+                coreEnergy[i] = next();
+            }
+
+            smn.clear();
+            smn[0x00059800] = (uint32_t)(480 + next() % 160) << 21;    // Tctl
+            smn[0x00059804] = (0x3e << 16) | (next() & 0x10);           // HTC
+            for (uint32_t ccd = 0; ccd < 8; ccd++)
+                smn[0x00059954 + ccd * 4] = 0x800 | (0x2c0 + next() % 0x100);
+        }
+    } hw;
+}
+
+
+extern "C" int cpu_number(void) {
+    return (int)hw.cpu;
+}
+
+/**
+ *  Runs the action on every simulated CPU in turn, where the kernel runs them in parallel.
+ */
+extern "C" void mp_rendezvous_no_intrs(void (*action_func)(void *), void *arg) {
+    for (hw.cpu = 0; hw.cpu < hw.cpus; hw.cpu++)
+        action_func(arg);
+    hw.cpu = 0;
+}
+
+extern "C" int rdmsr_carefully(uint32_t msr, uint32_t *lo, uint32_t *hi) {
+    uint64_t value;
+    switch (msr) {
+        case MsrPwrUnit:
+            value = 0xA1003;
+            break;
+        case MsrPstateStatus:
+            value = hw.pstate[hw.cpu];
+            break;
+        case MsrCoreEnergy:
+            value = hw.coreEnergy[hw.cpu] += 20000 + hw.next() % 50000;
+            break;
+        case MsrPkgEnergy:
+            value = hw.packageEnergy += 0x40000;
+            break;
+        default:
+            return 1;
+    }
+    *lo = (uint32_t)value;
+    *hi = (uint32_t)(value >> 32);
+    return 0;
+}
+
+UInt32 IOPCIDevice::configRead32(IOPCIAddressSpace space, UInt8 offset) {
+    return offset == SmnData ? hw.smn[hw.smnIndex] : 0xffffffff;
+}
+
+void IOPCIDevice::configWrite32(IOPCIAddressSpace space, UInt8 offset, UInt32 data) {
+    if (offset == SmnIndex)
+        hw.smnIndex = data;
+    else if (offset == SmnData)
+        hw.smn[hw.smnIndex] = data;
+}
+
+
+/**
+ *  Sets up the provider state start() fills on hardware, from the simulated registers.
+ */
+struct SensorBenchProvider {
+    struct Key {
+        SMC_KEY key;
+        std::unique_ptr<VirtualSMCValue> value;
+    };
+
+    static void configure(SMCProcessorAMD *p, size_t cores, IOPCIDevice *pci) {
+        size_t ccds = (cores + CoresPerCcd - 1) / CoresPerCcd;
+        size_t packages = (cores + CoresPerPackage - 1) / CoresPerPackage;
+
+        p->totalNumberOfPhysicalCores = (uint32_t)cores;
+        p->ccdCount = (uint32_t)ccds;
+        p->cpuTopology.packageCount = (uint8_t)packages;
+        for (size_t i = 0; i < cores; i++) {
+            size_t pkg = i / CoresPerPackage;
+            p->cpuTopology.physicalCount[pkg]++;
+            p->cpuTopology.logicalCount[pkg]++;
+            p->cpuTopology.numberToPackage[i] = (uint8_t)pkg;
+            p->cpuTopology.numberToPhysical[i] = (uint8_t)(i % CoresPerPackage);
+            p->cpuTopology.numberToLogical[i] = (uint8_t)(i % CoresPerPackage);
+            p->coreToPackage[i] = (uint8_t)pkg;
+            p->coreToCcd[i] = (uint8_t)(i / CoresPerCcd);
+        }
+
+        const uint8_t granted[] = {
+            Capability::PowerUnit, Capability::PackageEnergy, Capability::CoreEnergy, Capability::CoreClock,
+            Capability::Tctl, Capability::HTC, Capability::CCDTemperature,
+        };
+        for (uint8_t c : granted)
+            p->capabilities |= Capability::bit(c);
+
+        p->fIOPCIDevice = pci;
+        p->ccdTemperatureBase = SMCProcessorAMD::kF17H_M70H_CCD1_TEMP;
+        p->ccdTemperatureCount = (uint32_t)std::min<size_t>(ccds, SMCProcessorAMD::kMaxCcdTemperatureRegisters);
+        for (size_t ccd = 0; ccd < p->ccdTemperatureCount; ccd++)
+            p->ccdRegister[ccd] = (uint8_t)ccd;
+
+        uint64_t powerUnit = 0;
+        if (p->read_msr(MsrPwrUnit, &powerUnit))
+            p->energyUnit = SensorDecode::energyUnitJoules(powerUnit);
+
+        // What start() and the first tick leave behind.
+        uint64_t packageEnergy = 0;
+        if (p->read_msr(MsrPkgEnergy, &packageEnergy)) {
+            p->lastUpdateEnergyValue = (uint32_t)packageEnergy;
+            p->lastUpdateTime = getCurrentTimeNs();
+        }
+        p->updatePackageTemp();
+        p->updateCoreTemperatures();
+    }
+
+    /**
+     *  The keys SMCProcessorAMD::setupKeysVsmc registers for this provider.
+     */
+    static bool addKeys(SMCProcessorAMD *provider, std::vector<Key> &keys) {
+        return provider->addSensorKeys([](void *context, SMC_KEY key, VirtualSMCValue *value) {
+            static_cast<std::vector<Key>*>(context)->push_back(Key {key, std::unique_ptr<VirtualSMCValue>(value)});
+            return true;
+        }, &keys);
+    }
+};
+
+
+/**
+ *  Stands in for the VirtualSMC keystore, which is what calls readAccess() on the kext.
+ */
+struct VirtualSMCKeystore {
+    static SMC_RESULT read(VirtualSMCValue *value, uint32_t *sink) {
+        SMC_RESULT result = value->readAccess();
+        uint32_t word;
+        memcpy(&word, value->data, sizeof(word));
+        *sink += word;
+        return result;
+    }
+};
+
+
+namespace {
+    /**
+     *  Median nanoseconds per call of fn over Runs runs of CallsPerRun calls.
+     */
+    template <typename Fn>
+    double medianNs(Fn fn) {
+        double samples[Runs];
+        for (unsigned r = 0; r < Runs; r++) {
+            auto begin = std::chrono::steady_clock::now();
+            for (unsigned t = 0; t < CallsPerRun; t++)
+                fn();
+            auto end = std::chrono::steady_clock::now();
+            samples[r] = std::chrono::duration<double, std::nano>(end - begin).count() / CallsPerRun;
+        }
+        std::sort(samples, samples + Runs);
+        return samples[Runs / 2];
+    }
+
+    struct Path {
+        const char *name;
+        double ns;
+    };
+
+    struct Result {
+        size_t cores;
+        size_t keys;
+        std::vector<Path> paths;
+        double pollCpuPercent;
+    };
+
+    /**
+     *  Each path as samplingTick runs it. The per-core paths cover every core of the
+     *  machine, one rendezvous per call.
+     */
+    Result benchCores(size_t cores) {
+        hw.reset(cores);
+        IOPCIDevice pci;
+        std::unique_ptr<SMCProcessorAMD> provider(new SMCProcessorAMD());
+        SMCProcessorAMD *p = provider.get();
+        SensorBenchProvider::configure(p, cores, &pci);
+
+        Result result {};
+        result.cores = cores;
+
+        result.paths.push_back({"clock_speed", medianNs([p]() {
+            mp_rendezvous_no_intrs([](void *obj) { static_cast<SMCProcessorAMD*>(obj)->updateClockSpeed(); }, p);
+        })});
+        result.paths.push_back({"core_energy", medianNs([p]() {
+            mp_rendezvous_no_intrs([](void *obj) { static_cast<SMCProcessorAMD*>(obj)->updateCoreEnergy(); }, p);
+        })});
+        result.paths.push_back({"package_temp", medianNs([p]() { p->updatePackageTemp(); })});
+        result.paths.push_back({"package_energy", medianNs([p]() { p->updatePackageEnergy(); })});
+        result.paths.push_back({"core_clocks_and_power", medianNs([p]() { p->updateCoreClocksAndPower(); })});
+        result.paths.push_back({"core_temperatures", medianNs([p]() { p->updateCoreTemperatures(); })});
+
+        std::vector<SensorBenchProvider::Key> keys;
+        SensorBenchProvider::addKeys(p, keys);
+        result.keys = keys.size();
+
+        uint32_t sink = 0;
+        double readAll = medianNs([&keys, &sink]() {
+            for (auto &key : keys)
+                VirtualSMCKeystore::read(key.value.get(), &sink);
+        });
+        sinkWord = sink;
+        result.paths.push_back({"read_all_keys", readAll});
+
+        // A monitoring app reading every key PollHz times a second.
+        result.pollCpuPercent = readAll * PollHz / 1e9 * 100.0;
+        return result;
+    }
+}
+
+
+int main(int argc, char **argv) {
+    FILE *out = argc > 1 ? fopen(argv[1], "w") : stdout;
+    if (!out) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    std::vector<Result> results;
+    for (size_t cores : CoreCounts)
+        results.push_back(benchCores(cores));
+
+    fprintf(out, "{\n  \"calls_per_run\": %u,\n  \"runs\": %u,\n  \"poll_hz\": %u,\n  \"results\": [\n",
+            CallsPerRun, Runs, PollHz);
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &r = results[i];
+        fprintf(out, "    {\"cores\": %zu, \"keys\": %zu, \"poll_cpu_percent\": %.5f, \"paths\": {\n",
+                r.cores, r.keys, r.pollCpuPercent);
+        for (size_t j = 0; j < r.paths.size(); j++) {
+            const Path &path = r.paths[j];
+            fprintf(out, "      \"%s\": {\"ns_per_call\": %.1f, \"calls_per_s\": %.0f}%s\n",
+                    path.name, path.ns, 1e9 / path.ns, j + 1 < r.paths.size() ? "," : "");
+        }
+        fprintf(out, "    }}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
@@ -0,0 +1,39 @@
+//
+//  kern_cpu.hpp
+//  SMCProcessorAMD host shim
+//
+
+#ifndef SMCShim_kern_cpu_hpp
+#define SMCShim_kern_cpu_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace CPUInfo {
+    static constexpr size_t MaxCpus = 256;
+
+    struct CpuTopology {
+        uint8_t packageCount {0};
+        uint8_t physicalCount[MaxCpus] {};
+        uint8_t logicalCount[MaxCpus] {};
+        uint8_t numberToPackage[MaxCpus] {};
+        uint8_t numberToPhysical[MaxCpus] {};
+        uint8_t numberToLogical[MaxCpus] {};
+
+        uint8_t totalPhysical() const {
+            uint8_t count = 0;
+            for (uint8_t i = 0; i < packageCount; i++)
+                count += physicalCount[i];
+            return count;
+        }
+
+        uint8_t numberToPhysicalUnique(uint8_t i) const {
+            uint8_t num = 0;
+            for (uint8_t j = 0; j < numberToPackage[i]; j++)
+                num += physicalCount[j];
+            return num + numberToPhysical[i];
+        }
+    };
+}
+
+#endif /* SMCShim_kern_cpu_hpp */
@@ -0,0 +1,18 @@
+//
+//  kern_time.hpp
+//  SMCProcessorAMD host shim
+//
+
+#ifndef SMCShim_kern_time_hpp
+#define SMCShim_kern_time_hpp
+
+#include <stdint.h>
+#include <time.h>
+
+inline uint64_t getCurrentTimeNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+#endif /* SMCShim_kern_time_hpp */
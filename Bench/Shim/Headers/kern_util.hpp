@@ -0,0 +1,22 @@
+//
+//  kern_util.hpp
+//  SMCProcessorAMD host shim
+//
+
+#ifndef SMCShim_kern_util_hpp
+#define SMCShim_kern_util_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define Stringify(a) #a
+#define xStringify(a) Stringify(a)
+
+/**
+ *  "1.0.2" to 102, the same packing as Lilu.
+ */
+constexpr size_t parseModuleVersion(const char *version) {
+    return (size_t)(version[0] - '0') * 100 + (size_t)(version[2] - '0') * 10 + (size_t)(version[4] - '0');
+}
+
+#endif /* SMCShim_kern_util_hpp */
@@ -0,0 +1,27 @@
+//
+//  IOLib.h
+//  SMCProcessorAMD host shim
+//
+//  Just enough of the kernel headers for SMCProcessorAMD.hpp and the key
+//  implementations to compile on the host. Nothing here talks to hardware.
+//
+
+#ifndef SMCShim_IOLib_h
+#define SMCShim_IOLib_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef uint8_t UInt8;
+typedef uint16_t UInt16;
+typedef uint32_t UInt32;
+typedef uint64_t UInt64;
+typedef int IOReturn;
+
+struct IOLock;
+
+#define IOLog(...) fprintf(stderr, __VA_ARGS__)
+
+#endif /* SMCShim_IOLib_h */
@@ -0,0 +1,32 @@
+//
+//  IOService.h
+//  SMCProcessorAMD host shim
+//
+
+#ifndef SMCShim_IOService_h
+#define SMCShim_IOService_h
+
+#include <IOKit/IOLib.h>
+
+class OSDictionary;
+class IONotifier;
+class IOWorkLoop;
+class IOMemoryDescriptor;
+class IOMemoryMap;
+
+/**
+ *  No OSMetaClass on the host, the class is an ordinary C++ class.
+ */
+#define OSDeclareDefaultStructors(className) private:
+
+class IOService {
+public:
+    virtual ~IOService() {}
+
+    virtual bool init(OSDictionary *dictionary = 0) { return true; }
+    virtual void free(void) {}
+    virtual bool start(IOService *provider) { return true; }
+    virtual void stop(IOService *provider) {}
+};
+
+#endif /* SMCShim_IOService_h */
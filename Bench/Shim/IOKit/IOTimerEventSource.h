@@ -0,0 +1,13 @@
+//
+//  IOTimerEventSource.h
+//  SMCProcessorAMD host shim
+//
+
+#ifndef SMCShim_IOTimerEventSource_h
+#define SMCShim_IOTimerEventSource_h
+
+#include <IOKit/IOService.h>
+
+class IOTimerEventSource;
+
+#endif /* SMCShim_IOTimerEventSource_h */
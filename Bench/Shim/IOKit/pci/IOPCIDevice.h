@@ -0,0 +1,25 @@
+//
+//  IOPCIDevice.h
+//  SMCProcessorAMD host shim
+//
+
+#ifndef SMCShim_IOPCIDevice_h
+#define SMCShim_IOPCIDevice_h
+
+#include <IOKit/IOService.h>
+
+union IOPCIAddressSpace {
+    UInt32 bits;
+};
+
+/**
+ *  Config space accessors the kext uses for the SMN index/data pair,
+ *  defined by the bench against its simulated registers.
+ */
+class IOPCIDevice : public IOService {
+public:
+    virtual UInt32 configRead32(IOPCIAddressSpace space, UInt8 offset);
+    virtual void configWrite32(IOPCIAddressSpace space, UInt8 offset, UInt32 data);
+};
+
+#endif /* SMCShim_IOPCIDevice_h */
@@ -0,0 +1,46 @@
+//
+//  AppleSmc.h
+//  SMCProcessorAMD host shim
+//
+
+#ifndef SMCShim_AppleSmc_h
+#define SMCShim_AppleSmc_h
+
+#include <stdint.h>
+
+typedef uint32_t SMC_KEY;
+typedef uint32_t SMC_KEY_TYPE;
+typedef uint8_t SMC_DATA;
+typedef uint8_t SMC_DATA_SIZE;
+
+#define SMC_MAKE_IDENTIFIER(A, B, C, D) \
+    ((uint32_t)(((uint32_t)(A) << 24U) | ((uint32_t)(B) << 16U) | ((uint32_t)(C) << 8U) | (uint32_t)(D)))
+
+#define SMC_MAKE_KEY_TYPE(A, B, C, D) SMC_MAKE_IDENTIFIER((A), (B), (C), (D))
+
+enum SMC_RESULT : uint8_t {
+    SmcSuccess = 0,
+    SmcError = 1,
+    SmcNotFound = 0x84,
+};
+
+static constexpr SMC_KEY_TYPE SmcKeyTypeFlag = SMC_MAKE_KEY_TYPE('f', 'l', 'a', 'g');
+static constexpr SMC_KEY_TYPE SmcKeyTypeFloat = SMC_MAKE_KEY_TYPE('f', 'l', 't', ' ');
+static constexpr SMC_KEY_TYPE SmcKeyTypeUint8 = SMC_MAKE_KEY_TYPE('u', 'i', '8', ' ');
+static constexpr SMC_KEY_TYPE SmcKeyTypeUint32 = SMC_MAKE_KEY_TYPE('u', 'i', '3', '2');
+static constexpr SMC_KEY_TYPE SmcKeyTypeSp3c = SMC_MAKE_KEY_TYPE('s', 'p', '3', 'c');
+static constexpr SMC_KEY_TYPE SmcKeyTypeSp78 = SMC_MAKE_KEY_TYPE('s', 'p', '7', '8');
+static constexpr SMC_KEY_TYPE SmcKeyTypeSp96 = SMC_MAKE_KEY_TYPE('s', 'p', '9', '6');
+
+/**
+ *  Proximity temperature keys the SDK defines and the kext reuses.
+ */
+static constexpr SMC_KEY KeyTp01 = SMC_MAKE_IDENTIFIER('T', 'p', '0', '1');
+static constexpr SMC_KEY KeyTp05 = SMC_MAKE_IDENTIFIER('T', 'p', '0', '5');
+static constexpr SMC_KEY KeyTp09 = SMC_MAKE_IDENTIFIER('T', 'p', '0', '9');
+static constexpr SMC_KEY KeyTp0D = SMC_MAKE_IDENTIFIER('T', 'p', '0', 'D');
+static constexpr SMC_KEY KeyTp0b = SMC_MAKE_IDENTIFIER('T', 'p', '0', 'b');
+static constexpr SMC_KEY KeyTp0f = SMC_MAKE_IDENTIFIER('T', 'p', '0', 'f');
+static constexpr SMC_KEY KeyTp0j = SMC_MAKE_IDENTIFIER('T', 'p', '0', 'j');
+
+#endif /* SMCShim_AppleSmc_h */
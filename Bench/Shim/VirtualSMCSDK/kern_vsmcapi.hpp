@@ -0,0 +1,90 @@
+//
+//  kern_vsmcapi.hpp
+//  SMCProcessorAMD host shim
+//
+//  Value storage and the sp/flt encoders with the same wire format as VirtualSMC.
+//  Keys are not registered anywhere, the bench collects them through
+//  SMCProcessorAMD::addSensorKeys and plays the keystore by calling readAccess() directly.
+//
+
+#ifndef SMCShim_kern_vsmcapi_hpp
+#define SMCShim_kern_vsmcapi_hpp
+
+#include <VirtualSMCSDK/AppleSmc.h>
+#include <libkern/libkern.h>
+#include <string.h>
+
+class VirtualSMCValue {
+    friend struct VirtualSMCKeystore;
+
+public:
+    static constexpr size_t SMC_MAX_DATA_SIZE = 32;
+
+    virtual ~VirtualSMCValue() {}
+
+protected:
+    SMC_KEY_TYPE type {0};
+    SMC_DATA_SIZE size {0};
+    SMC_DATA data[SMC_MAX_DATA_SIZE] {};
+
+    virtual SMC_RESULT readAccess() { return SmcSuccess; }
+
+public:
+    void setup(SMC_KEY_TYPE newType, SMC_DATA_SIZE newSize) {
+        type = newType;
+        size = newSize;
+    }
+};
+
+namespace VirtualSMCAPI {
+    static constexpr uint32_t Version = 1;
+
+    struct Plugin {
+        const char *product;
+        size_t version;
+        uint32_t apiver;
+    };
+
+    /**
+     *  Fraction bits of an sp type, the last character as a hex digit.
+     */
+    inline uint32_t spFraction(SMC_KEY_TYPE type) {
+        uint32_t c = type & 0xff;
+        return c >= 'a' ? c - 'a' + 10 : c - '0';
+    }
+
+    inline uint16_t encodeSp(SMC_KEY_TYPE type, double value) {
+        int16_t v = (int16_t)(value * (double)(1U << spFraction(type)));
+        return OSSwapHostToBigInt16((uint16_t)v);
+    }
+
+    inline uint32_t encodeFlt(float value) {
+        uint32_t v;
+        memcpy(&v, &value, sizeof(v));
+        return v;
+    }
+
+    inline VirtualSMCValue *valueWithSp(double, SMC_KEY_TYPE type, VirtualSMCValue *value = nullptr) {
+        if (!value)
+            value = new VirtualSMCValue;
+        value->setup(type, sizeof(uint16_t));
+        return value;
+    }
+
+    inline VirtualSMCValue *valueWithFlt(float, VirtualSMCValue *value) {
+        value->setup(SmcKeyTypeFloat, sizeof(uint32_t));
+        return value;
+    }
+
+    inline VirtualSMCValue *valueWithFlag(bool, VirtualSMCValue *value) {
+        value->setup(SmcKeyTypeFlag, sizeof(uint8_t));
+        return value;
+    }
+
+    inline VirtualSMCValue *valueWithUint32(uint32_t, VirtualSMCValue *value) {
+        value->setup(SmcKeyTypeUint32, sizeof(uint32_t));
+        return value;
+    }
+}
+
+#endif /* SMCShim_kern_vsmcapi_hpp */
@@ -0,0 +1,16 @@
+//
+//  proc_reg.h
+//  SMCProcessorAMD host shim
+//
+
+#ifndef SMCShim_proc_reg_h
+#define SMCShim_proc_reg_h
+
+#include <stdint.h>
+
+/**
+ *  Defined by the bench against its simulated MSR file. Returns non-zero when the MSR faults.
+ */
+extern "C" int rdmsr_carefully(uint32_t msr, uint32_t *lo, uint32_t *hi);
+
+#endif /* SMCShim_proc_reg_h */
@@ -0,0 +1,19 @@
+//
+//  libkern.h
+//  SMCProcessorAMD host shim
+//
+
+#ifndef SMCShim_libkern_h
+#define SMCShim_libkern_h
+
+#include <stdint.h>
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define OSSwapHostToBigInt16(x) ((uint16_t)__builtin_bswap16((uint16_t)(x)))
+#define OSSwapHostToBigInt32(x) ((uint32_t)__builtin_bswap32((uint32_t)(x)))
+#else
+#define OSSwapHostToBigInt16(x) ((uint16_t)(x))
+#define OSSwapHostToBigInt32(x) ((uint32_t)(x))
+#endif
+
+#endif /* SMCShim_libkern_h */
@@ -0,0 +1,56 @@
+//
+//  Capabilities.cpp
+//  SMCProcessorAMD
+//
+
+#include "Capabilities.hpp"
+
+
+const char *Capability::name(uint8_t capability){
+    switch (capability) {
+        case PowerUnit:             return "PowerUnit";
+        case PackageEnergy:         return "PackageEnergy";
+        case CoreEnergy:            return "CoreEnergy";
+        case CoreClock:             return "CoreClock";
+        case CorePerformanceBoost:  return "CorePerformanceBoost";
+        case L3Counters:            return "L3Counters";
+        case Tctl:                  return "Tctl";
+        case HTC:                   return "HTC";
+        case CCDTemperature:        return "CCDTemperature";
+        case SMU:                   return "SMU";
+    }
+    return "?";
+}
+
+Capability::Mask CapabilityProbe::run(const RegisterBackend &backend, const RegisterProbe *probes, size_t count, RegisterProbe::Space space){
+    Capability::Mask listed = 0;
+    Capability::Mask failed = 0;
+
+    for(size_t i = 0; i < count; i++){
+        const RegisterProbe &probe = probes[i];
+        if(probe.space != space || probe.capability >= Capability::Count)
+            continue;
+
+        Capability::Mask bit = Capability::bit(probe.capability);
+        listed |= bit;
+
+        // One failing register is enough, do not touch the rest of that capability.
+        if(failed & bit)
+            continue;
+
+        uint64_t value = 0;
+        bool ok;
+        if(space == RegisterProbe::MSR){
+            ok = backend.readMsr && backend.readMsr(backend.context, probe.addr, &value);
+        } else {
+            uint32_t smn = 0;
+            ok = backend.readSmn && backend.readSmn(backend.context, probe.addr, &smn);
+            value = smn;
+        }
+
+        if(!ok || (probe.valid && !probe.valid(value)))
+            failed |= bit;
+    }
+
+    return listed & ~failed;
+}
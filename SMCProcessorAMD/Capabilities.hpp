@@ -0,0 +1,86 @@
+//
+//  Capabilities.hpp
+//  SMCProcessorAMD
+//
+//  Startup probe of the MSR and SMN registers the sampler uses. Register access
+//  goes through RegisterBackend so the probe has no IOKit dependency and can run
+//  against a fault-injecting backend on the host.
+//
+
+#ifndef Capabilities_hpp
+#define Capabilities_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ *  Sensor features that depend on registers which may fault or read garbage,
+ *  typically under a hypervisor or on a model we do not know.
+ */
+namespace Capability {
+    enum : uint8_t {
+        PowerUnit,              // MSR_PWR_UNIT
+        PackageEnergy,          // MSR_PKG_ENERGY_STAT
+        CoreEnergy,             // MSR_CORE_ENERGY_STAT
+        CoreClock,              // MSR_HARDWARE_PSTATE_STATUS
+        CorePerformanceBoost,   // HWCR
+        L3Counters,             // L3 PMU config and counter MSRs
+        Tctl,                   // SMN THM_TCON_CUR_TMP
+        HTC,                    // SMN THM_TCON_HTC
+        CCDTemperature,         // SMN per-CCD temperature
+        SMU,                    // SMN SMU mailbox command/response/argument registers
+        Count
+    };
+
+    using Mask = uint32_t;
+
+    static constexpr Mask bit(uint8_t capability) { return 1u << capability; }
+
+    /**
+     *  Name used in logs and as the IORegistry key.
+     */
+    const char *name(uint8_t capability);
+}
+
+
+/**
+ *  Register reads used by the probe. A read returns false if the access faulted.
+ */
+struct RegisterBackend {
+    void *context;
+    bool (*readMsr)(void *context, uint32_t addr, uint64_t *value);
+    bool (*readSmn)(void *context, uint32_t addr, uint32_t *value);
+};
+
+
+/**
+ *  One register a capability depends on. A capability is granted only if
+ *  every register listed for it reads successfully and passes valid().
+ */
+struct RegisterProbe {
+    enum Space : uint8_t {
+        MSR,
+        SMN,
+    };
+
+    uint8_t capability;
+    Space space;
+    uint32_t addr;
+
+    /**
+     *  Optional check of the value read, e.g. a valid bit. nullptr accepts any value.
+     */
+    bool (*valid)(uint64_t value);
+};
+
+
+namespace CapabilityProbe {
+    /**
+     *  Probes the registers of one space and returns the capabilities granted.
+     *  Capabilities without a register in that space are never granted.
+     */
+    Capability::Mask run(const RegisterBackend &backend, const RegisterProbe *probes, size_t count, RegisterProbe::Space space);
+}
+
+#endif /* Capabilities_hpp */
@@ -0,0 +1,157 @@
+//
+//  CoreTopology.hpp
+//  SMCProcessorAMD
+//
+//  Core grouping and per-group statistics. No IOKit dependency.
+//
+
+#ifndef CoreTopology_hpp
+#define CoreTopology_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ *  Max, average and min of one quantity across a group of cores.
+ */
+struct SensorStats {
+    enum : uint8_t {
+        Max,
+        Average,
+        Min,
+        Count
+    };
+
+    float value[Count];
+};
+
+
+/**
+ *  Statistics of every per-core quantity for one CCD or package.
+ */
+struct CoreGroupStats {
+    enum : uint8_t {
+        Clock,          // MHz
+        Power,          // W
+        Temperature,    // °C
+        Count
+    };
+
+    SensorStats quantity[Count];
+};
+
+
+/**
+ *  Folds samples into SensorStats, NaN samples are skipped.
+ */
+class SensorAccumulator {
+    float max {0};
+    float min {0};
+    double sum {0};
+    uint32_t count {0};
+
+public:
+    void add(float v) {
+        if (v != v) return;
+        if (count == 0 || v > max) max = v;
+        if (count == 0 || v < min) min = v;
+        sum += v;
+        count++;
+    }
+
+    /**
+     *  An empty group reports zeros so SMC encoders never see NaN.
+     */
+    void store(SensorStats &out) const {
+        out.value[SensorStats::Max] = max;
+        out.value[SensorStats::Average] = count ? (float)(sum / count) : 0.0f;
+        out.value[SensorStats::Min] = min;
+    }
+};
+
+
+namespace CoreTopology {
+    /**
+     *  Number of low APIC id bits covering all threads that share one L3,
+     *  from CPUID Fn8000_001D (L3 subleaf) EAX[25:14] + 1.
+     */
+    inline uint8_t l3Shift(uint32_t threadsSharingL3) {
+        uint8_t shift = 0;
+        while (shift < 31 && (1u << shift) < threadsSharingL3)
+            shift++;
+        return shift;
+    }
+
+    /**
+     *  Renumbers sparse hardware group ids to 0..n-1 in ascending id order.
+     *  Returns the number of distinct groups, ids past maxGroups fold into the last group.
+     */
+    inline size_t compact(const uint32_t *raw, uint8_t *dense, size_t count, size_t maxGroups) {
+        size_t groups = 0;
+        uint32_t last = 0;
+        bool first = true;
+
+        for (size_t n = 0; n < count; n++) {
+            // Smallest id strictly greater than the previous group.
+            bool found = false;
+            uint32_t next = 0;
+            for (size_t i = 0; i < count; i++) {
+                if ((first || raw[i] > last) && (!found || raw[i] < next)) {
+                    next = raw[i];
+                    found = true;
+                }
+            }
+            if (!found) break;
+
+            for (size_t i = 0; i < count; i++) {
+                if (raw[i] == next)
+                    dense[i] = (uint8_t)(groups < maxGroups ? groups : maxGroups - 1);
+            }
+
+            groups++;
+            last = next;
+            first = false;
+        }
+
+        return groups < maxGroups ? groups : maxGroups;
+    }
+
+    /**
+     *  Maps dense CCD n to the n-th per-CCD temperature register that has its valid bit [11] set,
+     *  the way k10temp finds populated CCDs when some are fused off. All ones is an aborted read.
+     *  Returns the number of populated registers, at most maxCcds are mapped.
+     */
+    inline size_t populatedCcds(const uint32_t *raw, size_t registers, uint8_t *map, size_t maxCcds) {
+        size_t found = 0;
+        for (size_t i = 0; i < registers; i++) {
+            if (raw[i] == 0xFFFFFFFF || !(raw[i] & 0x800))
+                continue;
+            if (found < maxCcds)
+                map[found] = (uint8_t)i;
+            found++;
+        }
+        return found < maxCcds ? found : maxCcds;
+    }
+
+    /**
+     *  leaders[g] = first core of group g, for g < groups. Returns false if a group has no core.
+     */
+    inline bool leaders(const uint8_t *dense, size_t count, uint16_t *leaders, size_t groups) {
+        for (size_t g = 0; g < groups; g++)
+            leaders[g] = UINT16_MAX;
+
+        for (size_t i = count; i-- > 0;) {
+            if (dense[i] < groups)
+                leaders[dense[i]] = (uint16_t)i;
+        }
+
+        for (size_t g = 0; g < groups; g++) {
+            if (leaders[g] == UINT16_MAX)
+                return false;
+        }
+        return true;
+    }
+}
+
+#endif /* CoreTopology_hpp */
@@ -26,5 +26,63 @@ class TempPackage  : public AMDSupportVsmcValue { using AMDSupportVsmcValue::AMD
 class TempCore     : public AMDSupportVsmcValue { using AMDSupportVsmcValue::AMDSupportVsmcValue; protected: SMC_RESULT readAccess() override; };
 class ClockCore    : public AMDSupportVsmcValue { using AMDSupportVsmcValue::AMDSupportVsmcValue; protected: SMC_RESULT readAccess() override; };
 class EnergyPackage: public AMDSupportVsmcValue { using AMDSupportVsmcValue::AMDSupportVsmcValue; protected: SMC_RESULT readAccess() override; };
+class TempCoreSensor: public AMDSupportVsmcValue { using AMDSupportVsmcValue::AMDSupportVsmcValue; protected: SMC_RESULT readAccess() override; };
+class PowerCore    : public AMDSupportVsmcValue { using AMDSupportVsmcValue::AMDSupportVsmcValue; protected: SMC_RESULT readAccess() override; };
+
+
+/**
+ *  One statistic of one quantity across a CCD (perCcd) or a package, see CoreGroupStats.
+ */
+class CoreGroupValue : public AMDSupportVsmcValue {
+protected:
+    bool perCcd;
+    uint8_t quantity;
+    uint8_t statistic;
+    SMC_RESULT readAccess() override;
+public:
+    CoreGroupValue(SMCProcessorAMD *provider, size_t group, bool perCcd, uint8_t quantity, uint8_t statistic) :
+        AMDSupportVsmcValue(provider, group), perCcd(perCcd), quantity(quantity), statistic(statistic) {}
+};
+
+
+
+/**
+ *  HTC throttling state of a package.
+ */
+class ThrottleValue : public AMDSupportVsmcValue {
+public:
+    enum Field : uint8_t {
+        Active,
+        Entries,
+        Seconds,
+        Limit,
+    };
+protected:
+    Field field;
+    SMC_RESULT readAccess() override;
+public:
+    ThrottleValue(SMCProcessorAMD *provider, size_t package, Field field) :
+        AMDSupportVsmcValue(provider, package), field(field) {}
+};
+
+
+/**
+ *  A field of the SMU PM table, reads 0 while the table is not available.
+ */
+class PMTableValue : public AMDSupportVsmcValue {
+public:
+    enum Field : uint8_t {
+        PptValue,
+        TdcValue,
+        EdcValue,
+        CoreVoltage,
+    };
+protected:
+    Field field;
+    SMC_RESULT readAccess() override;
+public:
+    PMTableValue(SMCProcessorAMD *provider, size_t package, Field field) :
+        AMDSupportVsmcValue(provider, package), field(field) {}
+};
 
 #endif /* KeyImplementations_hpp */
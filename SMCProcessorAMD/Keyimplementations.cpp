@@ -5,6 +5,17 @@
 #include "KeyImplementations.hpp"
 
 
+static void encodeValue(SMC_KEY_TYPE type, SMC_DATA *data, double value) {
+    if (type == SmcKeyTypeFloat)
+        *reinterpret_cast<uint32_t *>(data) = VirtualSMCAPI::encodeFlt(value);
+    else if (type == SmcKeyTypeFlag || type == SmcKeyTypeUint8)
+        *data = (SMC_DATA)value;
+    else if (type == SmcKeyTypeUint32)
+        *reinterpret_cast<uint32_t *>(data) = OSSwapHostToBigInt32((uint32_t)value);
+    else
+        *reinterpret_cast<uint16_t *>(data) = VirtualSMCAPI::encodeSp(type, value);
+}
+
 SMC_RESULT TempPackage::readAccess() {
     uint16_t *ptr = reinterpret_cast<uint16_t *>(data);
     *ptr = VirtualSMCAPI::encodeSp(type, (double)provider->PACKAGE_TEMPERATURE_perPackage[0]);
@@ -20,8 +31,28 @@ SMC_RESULT TempCore::readAccess() {
 }
 
 SMC_RESULT ClockCore::readAccess() {
-    uint16_t *ptr = reinterpret_cast<uint16_t *>(data);
-    *ptr = VirtualSMCAPI::encodeSp(type, (double)provider->MSR_HARDWARE_PSTATE_STATUS_perCore[core]);
+    // flt keys report MHz, sp keys GHz
+    double clock = provider->CORE_CLOCK_perCore[core];
+    encodeValue(type, data, type == SmcKeyTypeFloat ? clock : clock / 1000.0);
+
+    return SmcSuccess;
+}
+
+SMC_RESULT TempCoreSensor::readAccess() {
+    encodeValue(type, data, provider->CORE_TEMPERATURE_perCore[core]);
+
+    return SmcSuccess;
+}
+
+SMC_RESULT PowerCore::readAccess() {
+    encodeValue(type, data, provider->CORE_POWER_perCore[core]);
+
+    return SmcSuccess;
+}
+
+SMC_RESULT CoreGroupValue::readAccess() {
+    const CoreGroupStats &stats = perCcd ? provider->STATS_perCcd[package] : provider->STATS_perPackage[package];
+    encodeValue(type, data, stats.quantity[quantity].value[statistic]);
 
     return SmcSuccess;
 }
@@ -35,3 +66,37 @@ SMC_RESULT EnergyPackage::readAccess(){
     return SmcSuccess;
 }
 
+SMC_RESULT ThrottleValue::readAccess() {
+    switch (field) {
+        case Active:
+            encodeValue(type, data, provider->throttleActive ? 1 : 0);
+            break;
+        case Entries:
+            encodeValue(type, data, provider->throttleEntries);
+            break;
+        case Seconds:
+            encodeValue(type, data, provider->throttledTimeNs / 1000000000.0);
+            break;
+        case Limit:
+            encodeValue(type, data, provider->throttleTemperatureLimit);
+            break;
+    }
+
+    return SmcSuccess;
+}
+
+SMC_RESULT PMTableValue::readAccess() {
+    const PMTelemetry &pm = provider->pmTelemetry;
+    float v = 0;
+    if (pm.valid) {
+        switch (field) {
+            case PptValue: v = pm.pptValue; break;
+            case TdcValue: v = pm.tdcValue; break;
+            case EdcValue: v = pm.edcValue; break;
+            case CoreVoltage: v = pm.coreVoltage; break;
+        }
+    }
+    encodeValue(type, data, v == v ? v : 0);
+
+    return SmcSuccess;
+}
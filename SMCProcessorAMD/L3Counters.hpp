@@ -0,0 +1,84 @@
+//
+//  L3Counters.hpp
+//  SMCProcessorAMD
+//
+//  L3 performance counter programming and per-CCX statistics.
+//  Header only, no IOKit dependency.
+//
+
+#ifndef L3Counters_hpp
+#define L3Counters_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ *  L3 hit rate and miss bandwidth of one CCX over the last interval.
+ */
+struct L3Stats {
+    uint64_t accesses;
+    uint64_t misses;
+    float hitRate;              // 0..1, 0 when there was no access
+    float missBandwidthMBps;    // misses * line size per second
+};
+
+
+namespace L3Counters {
+    static constexpr uint32_t LineSize = 64;
+
+    /**
+     *  L3 PMCs are 48 bits wide.
+     */
+    static constexpr uint64_t CounterMask = (1ULL << 48) - 1;
+
+    enum Event : uint8_t {
+        Accesses,
+        Misses,
+    };
+
+    /**
+     *  ChL3PmcCfg value counting event on all slices and threads of the CCX, 0 if the family has no L3 PMU we know.
+     *  Events and masks as used by Linux amd_uncore.
+     */
+    inline uint64_t config(uint8_t family, Event event) {
+        uint64_t cfg = 1ULL << 22;   // Enable
+
+        if (family == 0x17) {
+            // L3RequestG1.CachingL3CacheAccesses / L3CombClstrState.RequestMiss
+            cfg |= (event == Accesses) ? (0x80ULL << 8 | 0x01) : (0x01ULL << 8 | 0x06);
+            cfg |= 0xFULL << 48;     // SliceMask
+            cfg |= 0xFFULL << 56;    // ThreadMask
+        } else if (family == 0x19) {
+            // L3LookupState, all request types / misses
+            cfg |= (event == Accesses) ? (0xFFULL << 8 | 0x04) : (0x01ULL << 8 | 0x04);
+            cfg |= 1ULL << 46;       // EnAllSlices
+            cfg |= 1ULL << 47;       // EnAllCores
+            cfg |= 0x3ULL << 56;     // ThreadMask
+        } else {
+            return 0;
+        }
+
+        return cfg;
+    }
+
+    inline uint64_t delta(uint64_t now, uint64_t last) {
+        return (now - last) & CounterMask;
+    }
+
+    inline L3Stats compute(uint64_t accessNow, uint64_t accessLast, uint64_t missNow, uint64_t missLast, uint64_t elapsedNs) {
+        L3Stats s {};
+        s.accesses = delta(accessNow, accessLast);
+        s.misses = delta(missNow, missLast);
+
+        // Miss and access events count slightly different request sets, keep the ratio sane.
+        if (s.misses > s.accesses)
+            s.misses = s.accesses;
+
+        s.hitRate = s.accesses ? 1.0f - (float)s.misses / (float)s.accesses : 0.0f;
+        s.missBandwidthMBps = elapsedNs ? (float)((double)s.misses * LineSize * 1000.0 / (double)elapsedNs) : 0.0f;
+        return s;
+    }
+}
+
+#endif /* L3Counters_hpp */
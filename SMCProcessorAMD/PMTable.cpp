@@ -0,0 +1,110 @@
+//
+//  PMTable.cpp
+//  SMCProcessorAMD
+//
+
+#include "PMTable.hpp"
+
+
+static constexpr uint16_t U = PMTableLayout::Unmapped;
+
+/**
+ *  Built-in layouts. Only the limit/value block at the start of the table is mapped, it is the same in
+ *  every version below. Voltage and per-core offsets also depend on the core count of the part, so they
+ *  come from the PMTableLayouts property through addLayout() rather than from a guess here.
+ */
+static const PMTableLayout builtinLayouts[] = {
+    // version    size   PPT lim/val   TDC lim/val   THM lim/val   EDC lim/val   volt  cores  power  temp  clock
+    { 0x240903, 0x518, 0x000, 0x004, 0x008, 0x00C, 0x010, 0x014, 0x020, 0x024, U,    0,     U,     U,    U },  // Matisse
+    { 0x380804, 0x8A4, 0x000, 0x004, 0x008, 0x00C, 0x010, 0x014, 0x020, 0x024, U,    0,     U,     U,    U },  // Vermeer
+    { 0x380805, 0x8F0, 0x000, 0x004, 0x008, 0x00C, 0x010, 0x014, 0x020, 0x024, U,    0,     U,     U,    U },  // Vermeer
+};
+
+static bool fieldFits(uint16_t offset, uint32_t count, uint32_t size){
+    return offset == U || (uint32_t)offset + count * 4 <= size;
+}
+
+static float readField(const uint8_t *table, uint16_t offset, uint32_t index = 0){
+    if(offset == U)
+        return __builtin_nanf("");
+
+    float v;
+    __builtin_memcpy(&v, table + offset + index * 4, sizeof(v));
+    return v;
+}
+
+PMTable::PMTable(){
+    for(size_t i = 0; i < sizeof(builtinLayouts) / sizeof(builtinLayouts[0]); i++)
+        addLayout(builtinLayouts[i]);
+}
+
+bool PMTable::addLayout(const PMTableLayout &layout){
+    if(layout.size == 0 || layout.size > MaxSize || layout.coreSlots > PMTelemetry::MaxCores)
+        return false;
+
+    const uint16_t single[] = {
+        layout.pptLimit, layout.pptValue, layout.tdcLimit, layout.tdcValue,
+        layout.thmLimit, layout.thmValue, layout.edcLimit, layout.edcValue,
+        layout.coreVoltage,
+    };
+    for(size_t i = 0; i < sizeof(single) / sizeof(single[0]); i++){
+        if(!fieldFits(single[i], 1, layout.size))
+            return false;
+    }
+
+    if(!fieldFits(layout.corePower, layout.coreSlots, layout.size) ||
+       !fieldFits(layout.coreTemperature, layout.coreSlots, layout.size) ||
+       !fieldFits(layout.coreEffectiveClock, layout.coreSlots, layout.size))
+        return false;
+
+    for(size_t i = 0; i < layoutCount; i++){
+        if(layouts[i].version == layout.version){
+            layouts[i] = layout;
+            return true;
+        }
+    }
+
+    if(layoutCount >= MaxLayouts)
+        return false;
+
+    layouts[layoutCount++] = layout;
+    return true;
+}
+
+const PMTableLayout *PMTable::layoutFor(uint32_t version) const {
+    for(size_t i = 0; i < layoutCount; i++){
+        if(layouts[i].version == version)
+            return &layouts[i];
+    }
+    return nullptr;
+}
+
+bool PMTable::parse(uint32_t version, const uint8_t *table, size_t size, PMTelemetry &out) const {
+    out.valid = false;
+
+    const PMTableLayout *layout = layoutFor(version);
+    if(!layout || !table || size < layout->size)
+        return false;
+
+    out.version = version;
+    out.pptLimit = readField(table, layout->pptLimit);
+    out.pptValue = readField(table, layout->pptValue);
+    out.tdcLimit = readField(table, layout->tdcLimit);
+    out.tdcValue = readField(table, layout->tdcValue);
+    out.thmLimit = readField(table, layout->thmLimit);
+    out.thmValue = readField(table, layout->thmValue);
+    out.edcLimit = readField(table, layout->edcLimit);
+    out.edcValue = readField(table, layout->edcValue);
+    out.coreVoltage = readField(table, layout->coreVoltage);
+
+    out.coreSlots = layout->coreSlots;
+    for(uint32_t i = 0; i < PMTelemetry::MaxCores; i++){
+        bool slot = i < layout->coreSlots;
+        out.corePower[i] = slot ? readField(table, layout->corePower, i) : __builtin_nanf("");
+        out.coreTemperature[i] = slot ? readField(table, layout->coreTemperature, i) : __builtin_nanf("");
+        out.coreEffectiveClock[i] = slot ? readField(table, layout->coreEffectiveClock, i) * 1000.0f : __builtin_nanf("");
+    }
+
+    out.valid = true;
+    return true;
+}
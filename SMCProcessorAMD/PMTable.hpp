@@ -0,0 +1,109 @@
+//
+//  PMTable.hpp
+//  SMCProcessorAMD
+//
+//  Version keyed parser for the SMU power management (PM) table.
+//  Works on a plain byte buffer, no IOKit dependency.
+//
+
+#ifndef PMTable_hpp
+#define PMTable_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ *  Byte offsets of the fields we use in one PM table version.
+ *  All fields are 32 bit floats, Unmapped marks a field this version does not provide.
+ */
+struct PMTableLayout {
+    static constexpr uint16_t Unmapped = 0xffff;
+
+    uint32_t version;
+    uint32_t size;
+
+    uint16_t pptLimit;
+    uint16_t pptValue;
+    uint16_t tdcLimit;
+    uint16_t tdcValue;
+    uint16_t thmLimit;
+    uint16_t thmValue;
+    uint16_t edcLimit;
+    uint16_t edcValue;
+
+    /**
+     *  SVI2 core (VDDCR_CPU) voltage telemetry.
+     */
+    uint16_t coreVoltage;
+
+    /**
+     *  Per-core arrays hold coreSlots consecutive floats, one per core slot of the package,
+     *  including fused off cores. Effective clock is stored in GHz.
+     */
+    uint16_t coreSlots;
+    uint16_t corePower;
+    uint16_t coreTemperature;
+    uint16_t coreEffectiveClock;
+};
+
+
+/**
+ *  Fields extracted from one PM table, NaN for anything the layout does not map.
+ */
+struct PMTelemetry {
+    static constexpr size_t MaxCores = 64;
+
+    bool valid;
+    uint32_t version;
+
+    float pptLimit;         // W
+    float pptValue;
+    float tdcLimit;         // A
+    float tdcValue;
+    float thmLimit;         // °C
+    float thmValue;
+    float edcLimit;         // A
+    float edcValue;
+    float coreVoltage;      // V
+
+    uint32_t coreSlots;
+    float corePower[MaxCores];              // W
+    float coreTemperature[MaxCores];        // °C
+    float coreEffectiveClock[MaxCores];     // MHz
+};
+
+
+class PMTable {
+public:
+    /**
+     *  Largest table we copy out of DRAM.
+     */
+    static constexpr size_t MaxSize = 0x1000;
+    static constexpr size_t MaxLayouts = 16;
+
+    /**
+     *  Starts with the built-in layouts.
+     */
+    PMTable();
+
+    /**
+     *  Adds a layout or replaces the one with the same version.
+     *  Rejects layouts whose fields fall outside size or MaxSize.
+     */
+    bool addLayout(const PMTableLayout &layout);
+
+    const PMTableLayout *layoutFor(uint32_t version) const;
+
+    /**
+     *  Decodes a table of the given version. Returns false and clears out.valid if the version is unknown
+     *  or the buffer is shorter than the layout.
+     */
+    bool parse(uint32_t version, const uint8_t *table, size_t size, PMTelemetry &out) const;
+
+private:
+    PMTableLayout layouts[MaxLayouts];
+    size_t layoutCount {0};
+};
+
+#endif /* PMTable_hpp */
@@ -1,4 +1,6 @@
 #include "SMCProcessorAMD.hpp"
+#include "SMCProcessorAMDUserClient.hpp"
+#include "SensorDecode.hpp"
 #include <Headers/kern_devinfo.hpp>
 
 // 定义元类和结构体
@@ -26,11 +28,31 @@ bool SMCProcessorAMD::init(OSDictionary *dictionary){
 
     IOLog("SMCProcessorAMD v%s, init\n", xStringify(MODULE_VERSION));
 
+    for(size_t i = 0; i < SensorId::Count; i++)
+        sensorValues[i] = __builtin_nanf("");
+
+    thresholdLock = IOLockAlloc();
+    if(!thresholdLock)
+        return false;
+
+    traceLock = IOLockAlloc();
+    if(!traceLock)
+        return false;
+
     return IOService::init(dictionary);
 }
 
 // 释放函数
 void SMCProcessorAMD::free(){
+    if(thresholdLock){
+        IOLockFree(thresholdLock);
+        thresholdLock = nullptr;
+    }
+    if(traceLock){
+        freeTrace();
+        IOLockFree(traceLock);
+        traceLock = nullptr;
+    }
     IOService::free();
 }
 
@@ -39,64 +61,9 @@ bool SMCProcessorAMD::setupKeysVsmc(){
 
     vsmcNotifier = VirtualSMCAPI::registerHandler(vsmcNotificationHandler, this);
 
-    bool suc = true;
-
-    // 读取CPU瓦特数
-    suc &= VirtualSMCAPI::addKey(KeyPCPR, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp96, new EnergyPackage(this, 0)));
-    suc &= VirtualSMCAPI::addKey(KeyPCPT, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp96, new EnergyPackage(this, 0)));
-    suc &= VirtualSMCAPI::addKey(KeyPCTR, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp96, new EnergyPackage(this, 0)));
-    VirtualSMCAPI::addKey(KeyVCxC(0), vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp3c, new EnergyPackage(this, 0)));
-
-    // Cpu TEMP
-    suc &= VirtualSMCAPI::addKey(KeyTCxD(0), vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempPackage(this, 0)));
-    suc &= VirtualSMCAPI::addKey(KeyTCxE(0), vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempPackage(this, 0)));
-    suc &= VirtualSMCAPI::addKey(KeyTCxF(0), vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempPackage(this, 0)));
-    suc &= VirtualSMCAPI::addKey(KeyTCxG(0), vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78));
-    suc &= VirtualSMCAPI::addKey(KeyTCxH(0), vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempPackage(this, 0)));
-    suc &= VirtualSMCAPI::addKey(KeyTCxJ(0), vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78));
-    suc &= VirtualSMCAPI::addKey(KeyTCxP(0), vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempPackage(this, 0)));
-    suc &= VirtualSMCAPI::addKey(KeyTCxp(0), vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempPackage(this, 0)));
-//    suc &= VirtualSMCAPI::addKey(KeyTCxT(0), vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempPackage(this, 0)));
-
-    // cpu温度
-    VirtualSMCAPI::addKey(KeyTp01, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
-    VirtualSMCAPI::addKey(KeyTp05, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
-    VirtualSMCAPI::addKey(KeyTp09, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
-    VirtualSMCAPI::addKey(KeyTp0D, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
-    VirtualSMCAPI::addKey(KeyTp0b, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
-    VirtualSMCAPI::addKey(KeyTp0f, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
-    VirtualSMCAPI::addKey(KeyTp0j, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
-
-    size_t coreOffset = 0;
-    auto model = BaseDeviceInfo::get().modelIdentifier;
-    auto isdigit = [](auto l) { return l >= '0' && l <= '8'; };
-    bool isMob = !strncmp(model, "MacBook", strlen("MacBook"));
-
-    // 只有第一个核心是真正的CPU温度，其它的全是频率(GHz *10，比如3.3Ghz显示的是33）
-    for(int core = 0; core <= this->totalNumberOfPhysicalCores; core++){
-//        if (core==0) {
-//            VirtualSMCAPI::addKey(KeyTCxC(core), vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, core)));
-//            VirtualSMCAPI::addKey(KeyTCxc(core), vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, core)));
-//        } else {
-           // VirtualSMCAPI::addKey(KeyTCxC(core), vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new ClockCore(this, core)));
-//        }
-    }
-
-    VirtualSMCAPI::addKey(KeyTGDD, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
-    // 核显温度
-
-    VirtualSMCAPI::addKey(KeyVD0R, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
-
-
-    VirtualSMCAPI::addKey(KeyID0R, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
-
-    VirtualSMCAPI::addKey(KeyTH0B, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
-
-    // 电压
-    VirtualSMCAPI::addKey(KeyTW0P, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
-
-    // 分扇监控
-    VirtualSMCAPI::addKey(KeyF0Ac, vsmcPlugin.data, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
+    bool suc = addSensorKeys([](void *context, SMC_KEY key, VirtualSMCValue *value) {
+        return VirtualSMCAPI::addKey(key, static_cast<SMCProcessorAMD*>(context)->vsmcPlugin.data, value);
+    }, this);
 
     if(!suc){
         IOLog("SMCProcessorAMD::setupKeysVsmc: VirtualSMCAPI::addKey returned false. \n");
@@ -197,7 +164,7 @@ bool SMCProcessorAMD::start(IOService *provider){
     
     CPUInfo::getCpuid(1, 0, &cpuid_eax, &cpuid_ebx, &cpuid_ecx, &cpuid_edx);
     cpuFamily = ((cpuid_eax >> 20) & 0xff) + ((cpuid_eax >> 8) & 0xf);
-    cpuModel = ((cpuid_eax >> 16) & 0xf) + ((cpuid_eax >> 4) & 0xf);
+    cpuModel = ((cpuid_eax >> 12) & 0xf0) | ((cpuid_eax >> 4) & 0xf);
     
     //Only 17h Family are supported offically by now.
     cpuSupportedByCurrentVersion = (cpuFamily == 0x17)? 1 : 0;
@@ -248,24 +215,21 @@ bool SMCProcessorAMD::start(IOService *provider){
     totalNumberOfPhysicalCores = cpuTopology.totalPhysical();
     totalNumberOfLogicalCores = cpuTopology.totalLogical();
     
+    setupCoreTopology();
+    
+    //CCD temperature registers, offsets from k10temp.
+    if(cpuFamily == 0x17 && (cpuModel == 0x31 || cpuModel == 0x71))
+        ccdTemperatureBase = kF17H_M70H_CCD1_TEMP;
+    else if(cpuFamily == 0x19 && (cpuModel <= 0x01 || (cpuModel >= 0x20 && cpuModel <= 0x2f)))
+        ccdTemperatureBase = kF17H_M70H_CCD1_TEMP;
+    else if(cpuFamily == 0x19 && ((cpuModel >= 0x10 && cpuModel <= 0x1f) || (cpuModel >= 0x60 && cpuModel <= 0x7f)))
+        ccdTemperatureBase = kF19H_M10H_CCD1_TEMP;
     
     workLoop = IOWorkLoop::workLoop();
     timerEventSource = IOTimerEventSource::timerEventSource(this, [](OSObject *object, IOTimerEventSource *sender) {
         SMCProcessorAMD *provider = OSDynamicCast(SMCProcessorAMD, object);
         
-        
-        mp_rendezvous_no_intrs([](void *obj) {
-            auto provider = static_cast<SMCProcessorAMD*>(obj);
-            
-            //Read current clock speed from MSR for each core
-            provider->updateClockSpeed();
-        }, provider);
-        
-        //Read stats from package.
-        provider->updatePackageTemp();
-        provider->updatePackageEnergy();
-        
-        provider->timerEventSource->setTimeoutMS(1000);
+        provider->samplingTick();
     });
         
     IOLog("SMCProcessorAMD::start trying to init PCI service...\n");
@@ -274,11 +238,32 @@ bool SMCProcessorAMD::start(IOService *provider){
         return false;
     }
     
+    setupCcdTemperature();
+    probeCapabilities();
+    setupL3Counters();
+    
+    uint64_t powerUnit = 0;
+    if(hasCapability(Capability::PowerUnit) && read_msr(kMSR_PWR_UNIT, &powerUnit))
+        energyUnit = SensorDecode::energyUnitJoules(powerUnit);
+    
+    IOLog("SMCProcessorAMD::start trying to init SMU PM table...\n");
+    if(!setupPMTable()){
+        IOLog("SMCProcessorAMD::start PM table not available, using MSR/SMN sensors only.\n");
+    }
+    
+    // Prime the package energy counter so the first sample covers one period, not the uptime.
+    uint64_t now = getCurrentTimeNs();
+    uint64_t packageEnergy = 0;
+    if(hasCapability(Capability::PackageEnergy) && read_msr(kMSR_PKG_ENERGY_STAT, &packageEnergy)){
+        lastUpdateEnergyValue = (uint32_t)(packageEnergy & 0xffffffff);
+        lastUpdateTime = now;
+    }
     
-    lastUpdateTime = getCurrentTimeNs();
+    setupSamplingScheduler();
+    samplingScheduler.start(now);
     
     workLoop->addEventSource(timerEventSource);
-    timerEventSource->setTimeoutMS(1000);
+    armSamplingTimer();
     
     IOLog("SMCProcessorAMD::start registering VirtualSMC keys...\n");
     setupKeysVsmc();
@@ -292,14 +277,114 @@ bool SMCProcessorAMD::start(IOService *provider){
     return success;
 }
 
+void SMCProcessorAMD::setupSamplingScheduler(){
+    
+    // Info.plist key names, indexed by SamplingGroup.
+    static const char *groupNames[SamplingGroup::Count] = {
+        "Temperature",
+        "PackagePower",
+        "CoreClocks",
+        "PMTable",
+    };
+    
+    // Registers behind each group, indexed by SamplingGroup. The PM table also needs setupPMTable to have mapped it.
+    static const Capability::Mask groupCapabilities[SamplingGroup::Count] = {
+        Capability::bit(Capability::Tctl) | Capability::bit(Capability::HTC) | Capability::bit(Capability::CCDTemperature),
+        Capability::bit(Capability::PackageEnergy),
+        Capability::bit(Capability::CoreClock) | Capability::bit(Capability::CoreEnergy) | Capability::bit(Capability::L3Counters),
+        Capability::bit(Capability::SMU),
+    };
+    
+    OSDictionary *intervals = OSDynamicCast(OSDictionary, getProperty("SamplingIntervals"));
+    
+    for(uint8_t group = 0; group < SamplingGroup::Count; group++){
+        uint32_t periodMs = kDefaultSamplingPeriodMs;
+        
+        OSNumber *custom = intervals ? OSDynamicCast(OSNumber, intervals->getObject(groupNames[group])) : nullptr;
+        if(custom)
+            periodMs = custom->unsigned32BitValue();
+        
+        // A group none of whose registers passed the probe is never sampled.
+        bool available = (capabilities & groupCapabilities[group]) != 0 &&
+            (group != SamplingGroup::PMTable || pmTableMap != nullptr);
+        if(!available){
+            samplingScheduler.setPeriod(group, 0);
+            IOLog("SMCProcessorAMD::setupSamplingScheduler: %s disabled, no usable registers\n", groupNames[group]);
+            continue;
+        }
+        
+        samplingScheduler.setPeriod(group, periodMs);
+        IOLog("SMCProcessorAMD::setupSamplingScheduler: %s every %u ms\n", groupNames[group], samplingScheduler.period(group));
+    }
+}
+
+void SMCProcessorAMD::armSamplingTimer(){
+    
+    uint64_t next = samplingScheduler.nextDeadline();
+    if(next == SamplingScheduler::Never)
+        return;
+    
+    uint64_t now = getCurrentTimeNs();
+    uint64_t delayUs = next > now ? (next - now) / 1000 : 0;
+    
+    timerEventSource->setTimeoutUS(delayUs ? (uint32_t)delayUs : 1);
+}
+
+void SMCProcessorAMD::samplingTick(){
+    
+    uint32_t due = samplingScheduler.collectDue(getCurrentTimeNs());
+    
+    if(due & SamplingGroup::bit(SamplingGroup::CoreClocks)){
+        mp_rendezvous_no_intrs([](void *obj) {
+            auto provider = static_cast<SMCProcessorAMD*>(obj);
+            
+            //Read current clock speed and energy counter from MSR for each core
+            provider->updateClockSpeed();
+            provider->updateCoreEnergy();
+            provider->updateL3Counters();
+        }, this);
+    }
+    
+    //Read stats from package.
+    if(due & SamplingGroup::bit(SamplingGroup::Temperature))
+        updatePackageTemp();
+    if(due & SamplingGroup::bit(SamplingGroup::PackagePower))
+        updatePackageEnergy();
+    
+    if(due & SamplingGroup::bit(SamplingGroup::PMTable))
+        updatePMTable();
+    
+    //Per-core columns and CCD/package aggregates, computed once here so key reads stay O(1).
+    //Each column is rebuilt with the group that feeds it, the PM table refreshes temperatures too.
+    if(due & SamplingGroup::bit(SamplingGroup::CoreClocks)){
+        updateCoreClocksAndPower();
+        updateL3Stats();
+    }
+    if(due & (SamplingGroup::bit(SamplingGroup::Temperature) | SamplingGroup::bit(SamplingGroup::PMTable)))
+        updateCoreTemperatures();
+    
+    if(due){
+        publishSensorValues();
+        evaluateThresholds();
+    }
+    
+    //One trace sample per core clock period, so trace timestamps follow a fixed cadence.
+    if(due & SamplingGroup::bit(SamplingGroup::CoreClocks))
+        recordTrace();
+    
+    armSamplingTimer();
+}
+
 void SMCProcessorAMD::setCPBState(bool enabled){
     IOLog("AMDCPUSupport::setCPBState enabled is %s\n", enabled?"true":"false");
 
     if(!cpbSupported) return;
     
     uint64_t hwConfig;
-    if(!read_msr(kHWCR, &hwConfig))
-        panic("AMDCPUSupport::setCPBState: wtf?");
+    if(!hasCapability(Capability::CorePerformanceBoost) || !read_msr(kHWCR, &hwConfig)){
+        IOLog("AMDCPUSupport::setCPBState: HWCR not accessible, leaving CPB untouched\n");
+        return;
+    }
     
     if(enabled){
         hwConfig &= ~(1 << 25);
@@ -319,8 +404,10 @@ void SMCProcessorAMD::setCPBState(bool enabled){
 
 bool SMCProcessorAMD::getCPBState(){
     uint64_t hwConfig;
-    if(!read_msr(kHWCR, &hwConfig))
-        panic("AMDCPUSupport::start: wtf?");
+    if(!hasCapability(Capability::CorePerformanceBoost) || !read_msr(kHWCR, &hwConfig)){
+        IOLog("AMDCPUSupport::getCPBState: HWCR not accessible\n");
+        return false;
+    }
     
     return !((hwConfig >> 25) & 0x1);
 }
@@ -337,101 +424,611 @@ void SMCProcessorAMD::stop(IOService *provider){
     IOLog("SMCProcessorAMD stopped, you have no more support :(\n");
     
     timerEventSource->cancelTimeout();
+    freePMTable();
+    
+    if(l3CountersEnabled)
+        programL3Counters(false);
     
     IOService::stop(provider);
 }
 
-bool SMCProcessorAMD::read_msr(uint32_t addr, uint64_t *value){
+void SMCProcessorAMD::probeCapabilities(){
+    
+    RegisterProbe probes[24];
+    size_t count = 0;
+    
+    auto add = [&](uint8_t capability, RegisterProbe::Space space, uint32_t addr, bool (*valid)(uint64_t)) {
+        probes[count++] = {capability, space, addr, valid};
+    };
+    
+    add(Capability::PowerUnit, RegisterProbe::MSR, kMSR_PWR_UNIT, nullptr);
+    add(Capability::PackageEnergy, RegisterProbe::MSR, kMSR_PKG_ENERGY_STAT, nullptr);
+    add(Capability::CoreEnergy, RegisterProbe::MSR, kMSR_CORE_ENERGY_STAT, nullptr);
+    add(Capability::CoreClock, RegisterProbe::MSR, kMSR_HARDWARE_PSTATE_STATUS, nullptr);
+    
+    if(cpbSupported)
+        add(Capability::CorePerformanceBoost, RegisterProbe::MSR, kHWCR, nullptr);
+    
+    if(L3Counters::config(cpuFamily, L3Counters::Accesses)){
+        add(Capability::L3Counters, RegisterProbe::MSR, kL3_PMC_CFG_0, nullptr);
+        add(Capability::L3Counters, RegisterProbe::MSR, kL3_PMC_CFG_0 + 2, nullptr);
+        add(Capability::L3Counters, RegisterProbe::MSR, kL3_PMC_CTR_0, nullptr);
+        add(Capability::L3Counters, RegisterProbe::MSR, kL3_PMC_CTR_0 + 2, nullptr);
+    }
+    
+    // Emulated root complexes tend to read 0 where real hardware never does.
+    add(Capability::Tctl, RegisterProbe::SMN, kF17H_M01H_THM_TCON_CUR_TMP, [](uint64_t value) {
+        return value != 0;
+    });
+    add(Capability::HTC, RegisterProbe::SMN, kF17H_M01H_THM_TCON_HTC, nullptr);
+    
+    // The first populated CCD must still report a valid reading.
+    if(ccdTemperatureCount)
+        add(Capability::CCDTemperature, RegisterProbe::SMN, ccdTemperatureBase + ccdRegister[0] * 4u, [](uint64_t value) {
+            return (value & 0x800) != 0;
+        });
+    
+    // SMU mailbox used for the PM table. An idle mailbox holds the status of the last message, never 0.
+    const SMUProfile *profile = SMUProfile::find(cpuFamily, cpuModel);
+    if(profile){
+        add(Capability::SMU, RegisterProbe::SMN, profile->rsmu.command, nullptr);
+        add(Capability::SMU, RegisterProbe::SMN, profile->rsmu.response, [](uint64_t value) {
+            return value != 0;
+        });
+        add(Capability::SMU, RegisterProbe::SMN, profile->rsmu.args, nullptr);
+    }
+    
+    RegisterBackend backend {};
+    backend.context = this;
+    backend.readMsr = [](void *context, uint32_t addr, uint64_t *value) {
+        return static_cast<SMCProcessorAMD*>(context)->read_msr(addr, value);
+    };
+    backend.readSmn = [](void *context, uint32_t addr, uint32_t *value) {
+        static_cast<SMCProcessorAMD*>(context)->read_smn(&addr, value, 1);
+        // A master abort on the index/data pair reads all ones.
+        return *value != 0xFFFFFFFF;
+    };
+    
+    struct ProbeArgs {
+        SMCProcessorAMD *provider;
+        const RegisterBackend *backend;
+        const RegisterProbe *probes;
+        size_t count;
+        Capability::Mask granted[MaxPackages];
+        bool probed[MaxPackages];
+    } args {this, &backend, probes, count, {}, {}};
+    
+    // MSRs are probed on the first core of every package, SMN once through the root complex.
+    mp_rendezvous_no_intrs([](void *obj) {
+        auto probe = static_cast<ProbeArgs*>(obj);
+        auto &topology = probe->provider->cpuTopology;
+        
+        uint32_t cpu_num = cpu_number();
+        uint8_t package = topology.numberToPackage[cpu_num];
+        if(topology.numberToLogical[cpu_num] != 0 || package >= MaxPackages)
+            return;
+        
+        probe->granted[package] = CapabilityProbe::run(*probe->backend, probe->probes, probe->count, RegisterProbe::MSR);
+        probe->probed[package] = true;
+    }, &args);
+    
+    Capability::Mask msr = ~(Capability::Mask)0;
+    size_t packages = cpuTopology.packageCount < MaxPackages ? cpuTopology.packageCount : MaxPackages;
+    for(size_t pkg = 0; pkg < packages; pkg++)
+        msr &= args.probed[pkg] ? args.granted[pkg] : 0;
+    
+    // Without a topology there is no package to pick, fall back to this CPU.
+    if(!packages)
+        msr = CapabilityProbe::run(backend, probes, count, RegisterProbe::MSR);
+    
+    Capability::Mask smn = fIOPCIDevice ? CapabilityProbe::run(backend, probes, count, RegisterProbe::SMN) : 0;
+    capabilities = msr | smn;
+    
+    OSDictionary *map = OSDictionary::withCapacity(Capability::Count);
+    for(uint8_t capability = 0; capability < Capability::Count; capability++){
+        bool available = hasCapability(capability);
+        if(!available)
+            IOLog("SMCProcessorAMD::probeCapabilities: %s unavailable\n", Capability::name(capability));
+        if(map)
+            map->setObject(Capability::name(capability), available ? kOSBooleanTrue : kOSBooleanFalse);
+    }
+    
+    if(map){
+        setProperty("Capabilities", map);
+        map->release();
+    }
+    
+    IOLog("SMCProcessorAMD::probeCapabilities: mask %08X\n", capabilities);
+}
+
+void SMCProcessorAMD::setupL3Counters(){
+    
+    // wrmsr on a missing MSR would not be recoverable, only program what passed the probe.
+    if(!hasCapability(Capability::L3Counters)){
+        IOLog("SMCProcessorAMD::setupL3Counters: L3 PMU not available on Family %02Xh\n", cpuFamily);
+        return;
+    }
+    
+    uint32_t ccxs = ccxCount < MaxCcxs ? ccxCount : MaxCcxs;
+    size_t cores = totalNumberOfPhysicalCores < CPUInfo::MaxCpus ? totalNumberOfPhysicalCores : CPUInfo::MaxCpus;
+    if(!CoreTopology::leaders(coreToCcx, cores, ccxLeader, ccxs)){
+        IOLog("SMCProcessorAMD::setupL3Counters: inconsistent CCX mapping\n");
+        return;
+    }
     
-    uint32_t lo, hi;
-//    IOLog("SMCProcessorAMD lalala \n");
-    int err = rdmsr_carefully(addr, &lo, &hi);
-//    IOLog("SMCProcessorAMD rdmsr_carefully %d\n", err);
+    programL3Counters(true);
+    lastL3UpdateTime = getCurrentTimeNs();
+    l3CountersEnabled = true;
     
-    if(!err) *value = lo | ((uint64_t)hi << 32);
+    IOLog("SMCProcessorAMD::setupL3Counters: counting L3 accesses/misses on %u CCX\n", ccxs);
+}
+
+void SMCProcessorAMD::programL3Counters(bool enable){
     
-    return err == 0;
+    void *args[] = {this, &enable};
+    
+    mp_rendezvous_no_intrs([](void *obj) {
+        auto provider = static_cast<SMCProcessorAMD*>(((void**)obj)[0]);
+        bool enable = *static_cast<bool*>(((void**)obj)[1]);
+        
+        uint32_t cpu_num = cpu_number();
+        uint8_t package = provider->cpuTopology.numberToPackage[cpu_num];
+        uint8_t logical = provider->cpuTopology.numberToLogical[cpu_num];
+        if (logical >= provider->cpuTopology.physicalCount[package])
+            return;
+        
+        uint8_t physical = provider->cpuTopology.numberToPhysicalUnique(cpu_num);
+        uint8_t ccx = provider->coreToCcx[physical];
+        if(ccx >= MaxCcxs || provider->ccxLeader[ccx] != physical)
+            return;
+        
+        uint64_t accessCfg = enable ? L3Counters::config(provider->cpuFamily, L3Counters::Accesses) : 0;
+        uint64_t missCfg = enable ? L3Counters::config(provider->cpuFamily, L3Counters::Misses) : 0;
+        provider->write_msr(kL3_PMC_CFG_0, accessCfg);
+        provider->write_msr(kL3_PMC_CFG_0 + 2, missCfg);
+        
+        provider->read_msr(kL3_PMC_CTR_0, &provider->lastL3AccessRaw[ccx]);
+        provider->read_msr(kL3_PMC_CTR_0 + 2, &provider->lastL3MissRaw[ccx]);
+        provider->l3AccessRaw[ccx] = provider->lastL3AccessRaw[ccx];
+        provider->l3MissRaw[ccx] = provider->lastL3MissRaw[ccx];
+    }, args);
 }
 
-void SMCProcessorAMD::updateClockSpeed(){
+void SMCProcessorAMD::updateL3Counters(){
+    
+    if(!l3CountersEnabled)
+        return;
     
     uint32_t cpu_num = cpu_number();
-            
+    
     // Ignore hyper-threaded cores
     uint8_t package = cpuTopology.numberToPackage[cpu_num];
     uint8_t logical = cpuTopology.numberToLogical[cpu_num];
     if (logical >= cpuTopology.physicalCount[package])
         return;
-            
+    
     uint8_t physical = cpuTopology.numberToPhysicalUnique(cpu_num);
-            
-    uint64_t msr_value_buf = 0;
-    bool err = !read_msr(kMSR_HARDWARE_PSTATE_STATUS, &msr_value_buf);
-    if(err) IOLog("SMCProcessorAMD::updateClockSpeed: failed somewhere");
+    uint8_t ccx = coreToCcx[physical];
+    if(ccx >= MaxCcxs || ccxLeader[ccx] != physical)
+        return;
+    
+    read_msr(kL3_PMC_CTR_0, &l3AccessRaw[ccx]);
+    read_msr(kL3_PMC_CTR_0 + 2, &l3MissRaw[ccx]);
+}
+
+void SMCProcessorAMD::updateL3Stats(){
     
-    //Convert register value to clock speed.
-    uint32_t eax = (uint32_t)(msr_value_buf & 0xffffffff);
+    if(!l3CountersEnabled)
+        return;
     
-    // MSRC001_0293
-    // CurHwPstate [24:22]
-    // CurCpuVid [21:14]
-    // CurCpuDfsId [13:8]
-    // CurCpuFid [7:0]
-    float curCpuDfsId = (float)((eax >> 8) & 0x3f);
-    float curCpuFid = (float)(eax & 0xff);
+    uint64_t time = getCurrentTimeNs();
+    uint64_t elapsed = time - lastL3UpdateTime;
+    lastL3UpdateTime = time;
     
-    float clock = curCpuFid / curCpuDfsId * 2.0f;
+    uint32_t ccxs = ccxCount < MaxCcxs ? ccxCount : MaxCcxs;
+    for(uint32_t ccx = 0; ccx < ccxs; ccx++){
+        L3_STATS_perCcx[ccx] = L3Counters::compute(l3AccessRaw[ccx], lastL3AccessRaw[ccx],
+                                                   l3MissRaw[ccx], lastL3MissRaw[ccx], elapsed);
+        lastL3AccessRaw[ccx] = l3AccessRaw[ccx];
+        lastL3MissRaw[ccx] = l3MissRaw[ccx];
+    }
+}
 
-    // IOLog("SMCProcessorAMD::updateClockSpeed: i am CPU %hhu, physical %hhu, %llu(%f)\n", package, physical, msr_value_buf, clock);
+bool SMCProcessorAMD::setupPMTable(){
+    
+    smuProfile = SMUProfile::find(cpuFamily, cpuModel);
+    if(!smuProfile){
+        IOLog("SMCProcessorAMD::setupPMTable: no SMU profile for Family %02Xh Model %02Xh\n", cpuFamily, cpuModel);
+        return false;
+    }
+    
+    // Polling a mailbox that faulted or reads as absent would only time out, twice per message.
+    if(!hasCapability(Capability::SMU)){
+        IOLog("SMCProcessorAMD::setupPMTable: SMU mailbox did not pass the probe\n");
+        return false;
+    }
+    
+    SMNBackend backend {};
+    backend.context = this;
+    backend.read = [](void *context, uint32_t addr, uint32_t *value) {
+        static_cast<SMCProcessorAMD*>(context)->read_smn(&addr, value, 1);
+        return true;
+    };
+    backend.write = [](void *context, uint32_t addr, uint32_t value) {
+        static_cast<SMCProcessorAMD*>(context)->write_smn(addr, value);
+        return true;
+    };
+    backend.delay = [](void *context, uint32_t us) {
+        IODelay(us);
+    };
+    
+    smuMailbox = new SMUMailbox(backend, smuProfile->rsmu);
+    if(!smuMailbox)
+        return false;
+    
+    loadPMTableLayouts();
+    
+    uint64_t address = 0;
+    SMUMailbox::Status status = smuMailbox->locatePmTable(*smuProfile, &pmTableVersion, &address);
+    if(status != SMUMailbox::OK || !address){
+        IOLog("SMCProcessorAMD::setupPMTable: locating PM table %s\n", SMUMailbox::statusName(status));
+        freePMTable();
+        return false;
+    }
+    
+    const PMTableLayout *layout = pmTableParser.layoutFor(pmTableVersion);
+    if(!layout){
+        IOLog("SMCProcessorAMD::setupPMTable: unsupported PM table version %06X\n", pmTableVersion);
+        freePMTable();
+        return false;
+    }
+    
+    pmTableDescriptor = IOMemoryDescriptor::withPhysicalAddress((IOPhysicalAddress)address, layout->size, kIODirectionIn);
+    pmTableMap = pmTableDescriptor ? pmTableDescriptor->map(kIOMapInhibitCache) : nullptr;
+    if(!pmTableMap){
+        IOLog("SMCProcessorAMD::setupPMTable: unable to map PM table at %llX\n", address);
+        freePMTable();
+        return false;
+    }
+    
+    // From here on messages come from the sampling timer, keep a wedged SMU from stalling it.
+    smuMailbox->setMaxPolls(SMUMailbox::TickPolls);
+    
+    IOLog("SMCProcessorAMD::setupPMTable: %s, version %06X, %u bytes at %llX\n",
+          smuProfile->name, pmTableVersion, layout->size, address);
+    return true;
+}
+
+void SMCProcessorAMD::loadPMTableLayouts(){
+    
+    // Optional PMTableLayouts array, each entry a dictionary of byte offsets keyed like PMTableLayout.
+    OSArray *entries = OSDynamicCast(OSArray, getProperty("PMTableLayouts"));
+    if(!entries)
+        return;
+    
+    for(unsigned int i = 0; i < entries->getCount(); i++){
+        OSDictionary *entry = OSDynamicCast(OSDictionary, entries->getObject(i));
+        OSNumber *version = entry ? OSDynamicCast(OSNumber, entry->getObject("Version")) : nullptr;
+        if(!version)
+            continue;
+        
+        const PMTableLayout *builtin = pmTableParser.layoutFor(version->unsigned32BitValue());
+        PMTableLayout layout {};
+        if(builtin){
+            layout = *builtin;
+        } else {
+            layout.version = version->unsigned32BitValue();
+            layout.pptLimit = layout.pptValue = layout.tdcLimit = layout.tdcValue = PMTableLayout::Unmapped;
+            layout.thmLimit = layout.thmValue = layout.edcLimit = layout.edcValue = PMTableLayout::Unmapped;
+            layout.coreVoltage = PMTableLayout::Unmapped;
+            layout.corePower = layout.coreTemperature = layout.coreEffectiveClock = PMTableLayout::Unmapped;
+        }
+        
+        auto field = [entry](const char *name, uint32_t current) {
+            OSNumber *n = OSDynamicCast(OSNumber, entry->getObject(name));
+            return n ? n->unsigned32BitValue() : current;
+        };
+        
+        layout.size = field("Size", layout.size);
+        layout.pptLimit = (uint16_t)field("PPTLimit", layout.pptLimit);
+        layout.pptValue = (uint16_t)field("PPTValue", layout.pptValue);
+        layout.tdcLimit = (uint16_t)field("TDCLimit", layout.tdcLimit);
+        layout.tdcValue = (uint16_t)field("TDCValue", layout.tdcValue);
+        layout.thmLimit = (uint16_t)field("THMLimit", layout.thmLimit);
+        layout.thmValue = (uint16_t)field("THMValue", layout.thmValue);
+        layout.edcLimit = (uint16_t)field("EDCLimit", layout.edcLimit);
+        layout.edcValue = (uint16_t)field("EDCValue", layout.edcValue);
+        layout.coreVoltage = (uint16_t)field("CoreVoltage", layout.coreVoltage);
+        layout.coreSlots = (uint16_t)field("CoreSlots", layout.coreSlots);
+        layout.corePower = (uint16_t)field("CorePower", layout.corePower);
+        layout.coreTemperature = (uint16_t)field("CoreTemperature", layout.coreTemperature);
+        layout.coreEffectiveClock = (uint16_t)field("CoreEffectiveClock", layout.coreEffectiveClock);
+        
+        if(!pmTableParser.addLayout(layout))
+            IOLog("SMCProcessorAMD::loadPMTableLayouts: rejected layout for version %06X\n", layout.version);
+    }
+}
+
+void SMCProcessorAMD::updatePMTable(){
+    
+    if(!pmTableMap)
+        return;
+    
+    SMUMailbox::Status status = smuMailbox->transferPmTable(*smuProfile);
+    if(status != SMUMailbox::OK){
+        pmTelemetry.valid = false;
+        if(++pmTableFailures >= kMaxPMTableFailures){
+            IOLog("SMCProcessorAMD::updatePMTable: TransferTableToDram %s %u times in a row, stopping PM table sampling\n",
+                  SMUMailbox::statusName(status), pmTableFailures);
+            samplingScheduler.setPeriod(SamplingGroup::PMTable, 0);
+            freePMTable();
+        }
+        return;
+    }
+    pmTableFailures = 0;
+    
+    // One copy out of uncached memory, then parse from the local buffer.
+    IOByteCount size = pmTableMap->getLength();
+    if(size > sizeof(pmTableBuffer))
+        size = sizeof(pmTableBuffer);
+    memcpy(pmTableBuffer, (const void *)pmTableMap->getVirtualAddress(), size);
+    
+    pmTableParser.parse(pmTableVersion, pmTableBuffer, size, pmTelemetry);
+}
 
-    MSR_HARDWARE_PSTATE_STATUS_perCore[physical] = clock;
+void SMCProcessorAMD::freePMTable(){
+    
+    pmTelemetry.valid = false;
+    OSSafeReleaseNULL(pmTableMap);
+    OSSafeReleaseNULL(pmTableDescriptor);
+    
+    if(smuMailbox){
+        delete smuMailbox;
+        smuMailbox = nullptr;
+    }
 }
 
-void SMCProcessorAMD::updatePackageTemp(){
+void SMCProcessorAMD::identifyCore(){
+    
+    uint32_t cpu_num = cpu_number();
     
-    IOPCIAddressSpace space;
-    space.bits = 0x00;
+    // Ignore hyper-threaded cores
+    uint8_t package = cpuTopology.numberToPackage[cpu_num];
+    uint8_t logical = cpuTopology.numberToLogical[cpu_num];
+    if (logical >= cpuTopology.physicalCount[package])
+        return;
+    
+    uint8_t physical = cpuTopology.numberToPhysicalUnique(cpu_num);
+    
+    uint32_t eax = 0, ebx = 0, ecx = 0, edx = 0;
     
-    fIOPCIDevice->configWrite32(space, (UInt8)kFAMILY_17H_PCI_CONTROL_REGISTER, (UInt32)kF17H_M01H_THM_TCON_CUR_TMP);
-    uint32_t temperature = fIOPCIDevice->configRead32(space, kFAMILY_17H_PCI_CONTROL_REGISTER + 4);
+    // CPUID Fn8000_001E: extended APIC id
+    CPUInfo::getCpuid(0x8000001E, 0, &eax, &ebx, &ecx, &edx);
+    coreApicId[physical] = eax;
+    coreToPackage[physical] = package;
     
+    // EBX[15:8] is threads per core minus one
+    coreThreadShift = CoreTopology::l3Shift(((ebx >> 8) & 0xff) + 1);
     
-    bool tempOffsetFlag = (temperature & kF17H_TEMP_OFFSET_FLAG) != 0;
-    temperature = (temperature >> 21) * 125;
+    // CPUID Fn8000_001D subleaf 3: L3, EAX[25:14] is threads sharing it minus one
+    CPUInfo::getCpuid(0x8000001D, 3, &eax, &ebx, &ecx, &edx);
+    if(((eax >> 5) & 0x7) == 3)
+        coreL3Sharing = ((eax >> 14) & 0xfff) + 1;
+}
+
+void SMCProcessorAMD::setupCoreTopology(){
+    
+    mp_rendezvous_no_intrs([](void *obj) {
+        static_cast<SMCProcessorAMD*>(obj)->identifyCore();
+    }, this);
+    
+    size_t cores = totalNumberOfPhysicalCores;
+    if(cores > CPUInfo::MaxCpus)
+        cores = CPUInfo::MaxCpus;
     
-    float t = temperature * 0.001f;
+    // A CCX is the set of cores behind one L3. Family 17h packs two CCX in a CCD, later families one.
+    uint8_t ccxShift = CoreTopology::l3Shift(coreL3Sharing);
+    uint8_t ccdShift = ccxShift + ((cpuFamily == 0x17) ? 1 : 0);
     
-    t -= tempOffset;
+    uint32_t raw[CPUInfo::MaxCpus] {};
+    // PM table core slots follow the APIC core id, fused off cores keep their slot.
+    for(size_t i = 0; i < cores; i++)
+        corePmSlot[i] = (uint8_t)(coreApicId[i] >> coreThreadShift);
     
-    if (tempOffsetFlag)
-        t -= 49.0f;
+    for(size_t i = 0; i < cores; i++)
+        raw[i] = coreApicId[i] >> ccxShift;
+    ccxCount = (uint32_t)CoreTopology::compact(raw, coreToCcx, cores, CPUInfo::MaxCpus);
     
+    for(size_t i = 0; i < cores; i++)
+        raw[i] = coreApicId[i] >> ccdShift;
+    ccdCount = (uint32_t)CoreTopology::compact(raw, coreToCcd, cores, MaxCcds);
     
-    PACKAGE_TEMPERATURE_perPackage[0] = t;
-//    IOLog("SMCProcessorAMD::updatePackageTemp: read from pci device %d \n", (int)PACKAGE_TEMPERATURE_perPackage[0]);
+    IOLog("SMCProcessorAMD::setupCoreTopology: %u CCX, %u CCD (L3 shared by %u threads)\n",
+          ccxCount, ccdCount, coreL3Sharing);
 }
 
-void SMCProcessorAMD::updatePackageEnergy(){
+void SMCProcessorAMD::setupCcdTemperature(){
     
-    uint64_t time = getCurrentTimeNs();
+    if(!ccdTemperatureBase)
+        return;
     
-    uint64_t msr_value_buf = 0;
-    read_msr(kMSR_PKG_ENERGY_STAT, &msr_value_buf);
+    uint32_t addrs[kMaxCcdTemperatureRegisters];
+    uint32_t values[kMaxCcdTemperatureRegisters] {};
+    for(size_t i = 0; i < kMaxCcdTemperatureRegisters; i++)
+        addrs[i] = ccdTemperatureBase + (uint32_t)i * 4;
     
-    uint32_t energyValue = (uint32_t)(msr_value_buf & 0xffffffff);
+    read_smn(addrs, values, kMaxCcdTemperatureRegisters);
     
-    uint64_t energyDelta = (lastUpdateEnergyValue <= energyValue) ?
-        energyValue - lastUpdateEnergyValue : UINT64_MAX - lastUpdateEnergyValue;
+    size_t populated = CoreTopology::populatedCcds(values, kMaxCcdTemperatureRegisters, ccdRegister, MaxCcds);
+    if(populated != ccdCount)
+        IOLog("SMCProcessorAMD::setupCcdTemperature: %zu valid CCD temperature registers for %u CCD\n", populated, ccdCount);
     
-    double e = (0.0000153 * energyDelta) / ((time - lastUpdateTime) / 1000000000.0);
-    uniPackageEnergy = e;
+    ccdTemperatureCount = (uint32_t)(populated < ccdCount ? populated : ccdCount);
+}
+
+void SMCProcessorAMD::publishSensorValues(){
     
-    lastUpdateEnergyValue = energyValue;
-    lastUpdateTime = time;
+    sensorValues[SensorId::PackageTemperature] = PACKAGE_TEMPERATURE_perPackage[0];
+    sensorValues[SensorId::PackagePower] = (float)uniPackageEnergy;
+    sensorValues[SensorId::ThrottleActive] = throttleActive ? 1.0f : 0.0f;
     
-//    IOLog("SMCProcessorAMD::updatePackageEnergy: %d \n", (int)e);
-//    IOLog("SMCProcessorAMD::updatePackageEnergy: %d la\n", (int)energyDelta);
+    size_t cores = totalNumberOfPhysicalCores;
+    if(cores > arrsize(CORE_CLOCK_perCore))
+        cores = arrsize(CORE_CLOCK_perCore);
     
+    for(size_t core = 0; core < SensorId::MaxCores; core++){
+        sensorValues[SensorId::CoreClockBase + core] = (core < cores) ?
+            CORE_CLOCK_perCore[core] : __builtin_nanf("");
+    }
+}
+
+void SMCProcessorAMD::evaluateThresholds(){
+    
+    IOLockLock(thresholdLock);
+    if(thresholdEvaluator.subscriptionCount() > 0)
+        thresholdEvaluator.evaluate(sensorValues, getCurrentTimeNs(), postThresholdEvent, this);
+    IOLockUnlock(thresholdLock);
+}
+
+void SMCProcessorAMD::postThresholdEvent(void *owner, const ThresholdEvent &event, void *context){
+    static_cast<SMCProcessorAMDUserClient*>(owner)->enqueueThresholdEvent(event);
+}
+
+uint32_t SMCProcessorAMD::subscribeThreshold(const ThresholdSpec &spec, SMCProcessorAMDUserClient *client){
+    
+    IOLockLock(thresholdLock);
+    uint32_t id = thresholdEvaluator.subscribe(spec, client);
+    IOLockUnlock(thresholdLock);
+    
+    if(!id)
+        IOLog("SMCProcessorAMD::subscribeThreshold: rejected subscription on sensor %u\n", spec.sensor);
+    
+    return id;
+}
+
+bool SMCProcessorAMD::unsubscribeThreshold(uint32_t id, SMCProcessorAMDUserClient *client){
+    
+    IOLockLock(thresholdLock);
+    bool removed = thresholdEvaluator.unsubscribe(id, client);
+    IOLockUnlock(thresholdLock);
+    
+    return removed;
+}
+
+void SMCProcessorAMD::unsubscribeAllThresholds(SMCProcessorAMDUserClient *client){
+    
+    IOLockLock(thresholdLock);
+    thresholdEvaluator.unsubscribeAll(client);
+    IOLockUnlock(thresholdLock);
+}
+
+bool SMCProcessorAMD::startTrace(SMCProcessorAMDUserClient *client, uint16_t blockSamples){
+    
+    size_t cores = totalNumberOfPhysicalCores;
+    if(cores > TraceSnapshot::MaxCores)
+        cores = TraceSnapshot::MaxCores;
+    
+    // 采样点跟随核心频率组，该组关闭时没有可记录的内容
+    if(!samplingScheduler.period(SamplingGroup::CoreClocks)){
+        IOLog("SMCProcessorAMD::startTrace: core clock sampling is disabled\n");
+        return false;
+    }
+    
+    IOLockLock(traceLock);
+    
+    // 同一时间只允许一个客户端记录
+    if(traceClient){
+        IOLockUnlock(traceLock);
+        return false;
+    }
+    
+    if(!traceEncoder)
+        traceEncoder = new TraceEncoder;
+    
+    if(!traceEncoder || !traceEncoder->configure((uint16_t)cores, blockSamples)){
+        IOLockUnlock(traceLock);
+        IOLog("SMCProcessorAMD::startTrace: cannot trace %zu cores with %u samples per block\n", cores, blockSamples);
+        return false;
+    }
+    
+    size_t size = TraceFormat::maxBlockSize((uint16_t)cores, blockSamples);
+    if(traceBlockSize < size){
+        if(traceBlock)
+            IOFree(traceBlock, traceBlockSize);
+        traceBlock = static_cast<uint8_t*>(IOMalloc(size));
+        traceBlockSize = traceBlock ? size : 0;
+    }
+    
+    if(!traceBlock){
+        IOLockUnlock(traceLock);
+        IOLog("SMCProcessorAMD::startTrace: unable to allocate block buffer\n");
+        return false;
+    }
+    
+    traceClient = client;
+    IOLockUnlock(traceLock);
+    
+    IOLog("SMCProcessorAMD::startTrace: %zu cores, %u samples per block\n", cores, blockSamples);
+    return true;
+}
+
+void SMCProcessorAMD::stopTrace(SMCProcessorAMDUserClient *client){
+    
+    IOLockLock(traceLock);
+    if(traceClient == client){
+        // 未满的块也要交给客户端
+        flushTrace();
+        traceClient = nullptr;
+    }
+    IOLockUnlock(traceLock);
+}
+
+void SMCProcessorAMD::recordTrace(){
+    
+    IOLockLock(traceLock);
+    if(!traceClient){
+        IOLockUnlock(traceLock);
+        return;
+    }
+    
+    uint16_t cores = traceEncoder->coreCount();
+    
+    traceSnapshot.timestampNs = getCurrentTimeNs();
+    traceSnapshot.packageTemperature = PACKAGE_TEMPERATURE_perPackage[0];
+    traceSnapshot.packagePower = (float)uniPackageEnergy;
+    traceSnapshot.throttleActive = throttleActive;
+    traceSnapshot.coreCount = cores;
+    
+    for(uint16_t core = 0; core < cores; core++){
+        traceSnapshot.coreClock[core] = CORE_CLOCK_perCore[core];
+        traceSnapshot.corePower[core] = CORE_POWER_perCore[core];
+        traceSnapshot.coreTemperature[core] = CORE_TEMPERATURE_perCore[core];
+    }
+    
+    if(traceEncoder->append(traceSnapshot))
+        flushTrace();
+    
+    IOLockUnlock(traceLock);
+}
+
+void SMCProcessorAMD::flushTrace(){
+    
+    size_t size = traceEncoder->flush(traceBlock, traceBlockSize);
+    if(size)
+        traceClient->enqueueTraceBlock(traceBlock, size);
+}
+
+void SMCProcessorAMD::freeTrace(){
+    
+    if(traceEncoder){
+        delete traceEncoder;
+        traceEncoder = nullptr;
+    }
+    if(traceBlock){
+        IOFree(traceBlock, traceBlockSize);
+        traceBlock = nullptr;
+        traceBlockSize = 0;
+    }
 }
 
 EXPORT extern "C" kern_return_t ADDPR(kern_start)(kmod_info_t *, void *) {
@@ -20,6 +20,14 @@
 #include <VirtualSMCSDK/AppleSmc.h>
 
 #include "KeyImplementations.hpp"
+#include "SensorEvents.hpp"
+#include "CoreTopology.hpp"
+#include "SamplingScheduler.hpp"
+#include "SMUMailbox.hpp"
+#include "PMTable.hpp"
+#include "L3Counters.hpp"
+#include "TraceFormat.hpp"
+#include "Capabilities.hpp"
 
 
 extern "C" {
@@ -36,6 +44,9 @@ extern "C" {
 };
 
 
+class SMCProcessorAMDUserClient;
+
+
 /**
  * Offset table: https://github.com/torvalds/linux/blob/master/drivers/hwmon/k10temp.c#L78
  */
@@ -49,6 +60,11 @@ typedef struct tctl_offset {
 class SMCProcessorAMD : public IOService {
     OSDeclareDefaultStructors(SMCProcessorAMD)
     
+    /**
+     *  Host benchmark in Bench/, runs the sampler and key table against simulated registers.
+     */
+    friend struct SensorBenchProvider;
+    
     /**
      *  VirtualSMC service registration notifier
      */
@@ -73,7 +89,9 @@ class SMCProcessorAMD : public IOService {
     static constexpr uint32_t kCOFVID_STATUS = 0xC0010071;
     static constexpr uint32_t k17H_M01H_SVI = 0x0005A000;
     static constexpr uint32_t kF17H_M01H_THM_TCON_CUR_TMP = 0x00059800;
+    static constexpr uint32_t kF17H_M01H_THM_TCON_HTC = 0x00059804;
     static constexpr uint32_t kF17H_M70H_CCD1_TEMP = 0x00059954;
+    static constexpr uint32_t kF19H_M10H_CCD1_TEMP = 0x00059B08;
     static constexpr uint32_t kF17H_TEMP_OFFSET_FLAG = 0x80000;
     static constexpr uint8_t kFAMILY_17H_PCI_CONTROL_REGISTER = 0x60;
     static constexpr uint32_t kHWCR = 0xC0010015;
@@ -84,6 +102,13 @@ class SMCProcessorAMD : public IOService {
     static constexpr uint32_t kMSR_PWR_UNIT = 0xC0010299;
     static constexpr uint32_t kPERF_CTL_0 = 0xC0010000;
     static constexpr uint32_t kPERF_CTR_0 = 0xC0010004;
+    static constexpr uint32_t kL3_PMC_CFG_0 = 0xC0010230;
+    static constexpr uint32_t kL3_PMC_CTR_0 = 0xC0010231;
+    
+    /**
+     *  Sampling period of a group missing from the SamplingIntervals property.
+     */
+    static constexpr uint32_t kDefaultSamplingPeriodMs = 1000;
 
     
     /**
@@ -112,6 +137,17 @@ class SMCProcessorAMD : public IOService {
     static constexpr SMC_KEY KeyTCxc(size_t i) { return SMC_MAKE_IDENTIFIER('T','C',KeyIndexes[i],'c'); }
     static constexpr SMC_KEY KeyTCxC(size_t i) { return SMC_MAKE_IDENTIFIER('T','C',KeyIndexes[i],'C'); }
 	static constexpr SMC_KEY KeyVCxC(size_t i) { return SMC_MAKE_IDENTIFIER('V','C',KeyIndexes[i],'C'); }
+    static constexpr SMC_KEY KeyPCxC(size_t i) { return SMC_MAKE_IDENTIFIER('P','C',KeyIndexes[i],'C'); }
+    static constexpr SMC_KEY KeyCCxC(size_t i) { return SMC_MAKE_IDENTIFIER('C','C',KeyIndexes[i],'C'); }
+    
+    /**
+     *  Aggregate keys: <quantity><group><index><statistic>
+     *  quantity C(lock)/P(ower)/T(emperature), group D (CCD) or K (package), statistic M(ax)/A(verage)/N (min).
+     */
+    static constexpr char KeyQuantity(uint8_t q) { return q == CoreGroupStats::Clock ? 'C' : q == CoreGroupStats::Power ? 'P' : 'T'; }
+    static constexpr char KeyStatistic(uint8_t s) { return s == SensorStats::Max ? 'M' : s == SensorStats::Average ? 'A' : 'N'; }
+    static constexpr SMC_KEY KeyxDxx(uint8_t q, size_t i, uint8_t s) { return SMC_MAKE_IDENTIFIER(KeyQuantity(q),'D',KeyIndexes[i],KeyStatistic(s)); }
+    static constexpr SMC_KEY KeyxKxx(uint8_t q, size_t i, uint8_t s) { return SMC_MAKE_IDENTIFIER(KeyQuantity(q),'K',KeyIndexes[i],KeyStatistic(s)); }
 
 
     static constexpr SMC_KEY KeyTGDD = SMC_MAKE_IDENTIFIER('T', 'G', 'D', 'D');
@@ -121,6 +157,14 @@ class SMCProcessorAMD : public IOService {
     static constexpr SMC_KEY KeyTH0B = SMC_MAKE_IDENTIFIER('T', 'H', '0', 'B');
     static constexpr SMC_KEY KeyTW0P = SMC_MAKE_IDENTIFIER('T', 'W', '0', 'P');
     static constexpr SMC_KEY KeyF0Ac = SMC_MAKE_IDENTIFIER('F', '0', 'A', 'c');
+    
+    /**
+     *  HTC throttling: active flag, entry count, throttled seconds, temperature limit.
+     */
+    static constexpr SMC_KEY KeyHTCA = SMC_MAKE_IDENTIFIER('H', 'T', 'C', 'A');
+    static constexpr SMC_KEY KeyHTCE = SMC_MAKE_IDENTIFIER('H', 'T', 'C', 'E');
+    static constexpr SMC_KEY KeyHTCT = SMC_MAKE_IDENTIFIER('H', 'T', 'C', 'T');
+    static constexpr SMC_KEY KeyHTCL = SMC_MAKE_IDENTIFIER('H', 'T', 'C', 'L');
 
 public:
     virtual bool init(OSDictionary *dictionary = 0) override;
@@ -134,6 +178,12 @@ public:
      *  A simple wrapper for the kernel function readmsr_carefully.
      */
     bool read_msr(uint32_t addr, uint64_t *value);
+    
+    /**
+     *  Reads SMN registers back to back through the root complex index/data pair.
+     */
+    void read_smn(const uint32_t *addrs, uint32_t *values, size_t count);
+    void write_smn(uint32_t addr, uint32_t value);
     bool write_msr(uint32_t addr, uint64_t value);
     void setCPBState(bool enabled);
     bool getCPBState();
@@ -141,6 +191,28 @@ public:
     void updateClockSpeed();
     void updatePackageTemp();
     void updatePackageEnergy();
+    void updateCoreEnergy();
+    
+    /**
+     *  Per-core columns and their CCD/package statistics. Clocks and power follow the
+     *  CoreClocks group, temperatures the Temperature group.
+     */
+    void updateCoreClocksAndPower();
+    void updateCoreTemperatures();
+    void updateCoreAggregates(uint8_t quantity, const float *perCore);
+    
+    /**
+     *  Threshold subscriptions owned by user clients, evaluated once per tick.
+     */
+    uint32_t subscribeThreshold(const ThresholdSpec &spec, SMCProcessorAMDUserClient *client);
+    bool unsubscribeThreshold(uint32_t id, SMCProcessorAMDUserClient *client);
+    void unsubscribeAllThresholds(SMCProcessorAMDUserClient *client);
+    
+    /**
+     *  Binary trace of one snapshot per CoreClocks period, streamed to one user client in blocks.
+     */
+    bool startTrace(SMCProcessorAMDUserClient *client, uint16_t blockSamples);
+    void stopTrace(SMCProcessorAMDUserClient *client);
     
     uint32_t totalNumberOfPhysicalCores;
     uint32_t totalNumberOfLogicalCores;
@@ -158,32 +230,208 @@ public:
     char boardName[64]{};
     bool boardInfoValid;
     
+    static constexpr size_t MaxCcds = 16;
+    static constexpr size_t MaxPackages = 4;
+    static constexpr size_t MaxCcxs = 32;
+    
     /**
      *  Hard allocate space for cached readings.
      */
-    uint64_t MSR_HARDWARE_PSTATE_STATUS_perCore[24] {};
+    uint64_t MSR_HARDWARE_PSTATE_STATUS_perCore[CPUInfo::MaxCpus] {};
     float PACKAGE_TEMPERATURE_perPackage[CPUInfo::MaxCpus];
     
+    /**
+     *  Per physical core readings: clock in MHz, power in W.
+     */
+    float CORE_CLOCK_perCore[CPUInfo::MaxCpus] {};
+    float CORE_POWER_perCore[CPUInfo::MaxCpus] {};
+    float CORE_TEMPERATURE_perCore[CPUInfo::MaxCpus] {};
+    
+    /**
+     *  CCD temperature in °C, NaN when the part does not report it.
+     */
+    float CCD_TEMPERATURE_perCcd[MaxCcds] {};
+    
+    /**
+     *  Max/average/min across the cores of each CCD and package, rebuilt with their column.
+     */
+    CoreGroupStats STATS_perCcd[MaxCcds] {};
+    CoreGroupStats STATS_perPackage[MaxPackages] {};
+    
+    /**
+     *  Physical core to CCX/CCD/package, dense indices.
+     */
+    uint8_t coreToCcx[CPUInfo::MaxCpus] {};
+    uint8_t coreToCcd[CPUInfo::MaxCpus] {};
+    uint8_t coreToPackage[CPUInfo::MaxCpus] {};
+    uint32_t ccxCount {1};
+    uint32_t ccdCount {1};
+    
+    /**
+     *  L3 accesses/misses per CCX from the L3 PMU, refreshed with the core clocks.
+     */
+    bool l3CountersEnabled {false};
+    L3Stats L3_STATS_perCcx[MaxCcxs] {};
+    
+    /**
+     *  Hardware thermal control (HTC) state, asserted by Tctl reaching the limit or by PROCHOT.
+     *  Sampled with the temperature, throttled time counts intervals ending in a throttled sample.
+     */
+    bool throttleActive {false};
+    uint32_t throttleEntries {0};
+    uint64_t throttledTimeNs {0};
+    float throttleTemperatureLimit {0};
+    
+    /**
+     *  Latest decoded SMU PM table, valid is false when the table is not available.
+     */
+    PMTelemetry pmTelemetry {};
+    
     bool cpbSupported;
     
-    uint64_t lastUpdateTime;
-    uint64_t lastUpdateEnergyValue;
+    /**
+     *  Package energy counter at the previous sample, primed in start(). A zero time means unprimed.
+     */
+    uint64_t lastUpdateTime {0};
+    uint64_t lastUpdateEnergyValue {0};
     
     double uniPackageEnergy;
     
+    /**
+     *  Latest value of every published sensor, indexed by SensorId. NaN if not sampled.
+     */
+    float sensorValues[SensorId::Count];
+    
+    /**
+     *  Registers that passed the startup probe on every package, see Capability.
+     *  The sampler never touches a register whose capability is missing.
+     */
+    Capability::Mask capabilities {0};
+    
+    bool hasCapability(uint8_t capability) const {
+        return (capabilities & Capability::bit(capability)) != 0;
+    }
+    
     
 private:
     
     IOWorkLoop *workLoop;
     IOTimerEventSource *timerEventSource;
     
+    /**
+     *  One timer wakeup per deadline, serving every group due at that point.
+     */
+    SamplingScheduler samplingScheduler;
+    
+    void setupSamplingScheduler();
+    void armSamplingTimer();
+    void samplingTick();
+    
     CPUInfo::CpuTopology cpuTopology {};
     
     IOPCIDevice *fIOPCIDevice;
     
     float tempOffset = 0;
     
+    /**
+     *  SMN address of the first CCD temperature register, 0 if not available.
+     */
+    uint32_t ccdTemperatureBase {0};
+    
+    /**
+     *  Hardware register index of each dense CCD and how many CCDs have one.
+     *  Fused-off CCDs leave holes in the register file, so the two differ.
+     */
+    static constexpr size_t kMaxCcdTemperatureRegisters = 8;
+    uint8_t ccdRegister[MaxCcds] {};
+    uint32_t ccdTemperatureCount {0};
+    
+    /**
+     *  Joules per energy counter tick, from MSR_PWR_UNIT.
+     */
+    double energyUnit {0.0000153};
+    
+    uint32_t coreApicId[CPUInfo::MaxCpus] {};
+    uint32_t coreL3Sharing {1};
+    uint32_t coreEnergyRaw[CPUInfo::MaxCpus] {};
+    uint32_t lastCoreEnergyRaw[CPUInfo::MaxCpus] {};
+    uint64_t lastCoreUpdateTime {0};
+    uint64_t lastThrottleSampleTime {0};
+    
+    /**
+     *  Index of each physical core in the PM table per-core arrays.
+     */
+    uint8_t corePmSlot[CPUInfo::MaxCpus] {};
+    uint32_t coreThreadShift {0};
+    
+    void identifyCore();
+    void setupCoreTopology();
+    void setupCcdTemperature();
+    
+    /**
+     *  L3 PMU state. Counters are shared by the CCX and driven from its first core only.
+     */
+    uint16_t ccxLeader[MaxCcxs] {};
+    uint64_t l3AccessRaw[MaxCcxs] {};
+    uint64_t l3MissRaw[MaxCcxs] {};
+    uint64_t lastL3AccessRaw[MaxCcxs] {};
+    uint64_t lastL3MissRaw[MaxCcxs] {};
+    uint64_t lastL3UpdateTime {0};
+    
+    void probeCapabilities();
+    void setupL3Counters();
+    void programL3Counters(bool enable);
+    void updateL3Counters();
+    void updateL3Stats();
+    
+    /**
+     *  SMU mailbox and the PM table it transfers to DRAM, refreshed by the PMTable sampling group.
+     */
+    const SMUProfile *smuProfile {nullptr};
+    SMUMailbox *smuMailbox {nullptr};
+    PMTable pmTableParser;
+    uint32_t pmTableVersion {0};
+    IOMemoryDescriptor *pmTableDescriptor {nullptr};
+    IOMemoryMap *pmTableMap {nullptr};
+    uint8_t pmTableBuffer[PMTable::MaxSize] {};
+    
+    /**
+     *  Consecutive failed transfers, the PMTable group is stopped at kMaxPMTableFailures.
+     */
+    static constexpr uint32_t kMaxPMTableFailures = 8;
+    uint32_t pmTableFailures {0};
+    
+    bool setupPMTable();
+    void loadPMTableLayouts();
+    void updatePMTable();
+    void freePMTable();
+    
+    IOLock *thresholdLock {nullptr};
+    ThresholdEvaluator thresholdEvaluator;
+    
+    void publishSensorValues();
+    void evaluateThresholds();
+    static void postThresholdEvent(void *owner, const ThresholdEvent &event, void *context);
+    
+    IOLock *traceLock {nullptr};
+    SMCProcessorAMDUserClient *traceClient {nullptr};
+    TraceEncoder *traceEncoder {nullptr};
+    uint8_t *traceBlock {nullptr};
+    size_t traceBlockSize {0};
+    TraceSnapshot traceSnapshot {};
+    
+    void recordTrace();
+    void flushTrace();
+    void freeTrace();
+    
     int (*wrmsr_carefully)(uint32_t, uint32_t, uint32_t) {nullptr};
+    
+    /**
+     *  Creates every SMC key and hands it to add, which registers it with VirtualSMC.
+     *  Returns false if add failed for one of the mandatory package keys.
+     */
+    typedef bool (*KeyAdder)(void *context, SMC_KEY key, VirtualSMCValue *value);
+    bool addSensorKeys(KeyAdder add, void *context);
     bool setupKeysVsmc();
     bool getPCIService();
     
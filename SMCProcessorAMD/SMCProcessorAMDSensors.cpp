@@ -0,0 +1,327 @@
+//
+//  SMCProcessorAMDSensors.cpp
+//  SMCProcessorAMD
+//
+//  Sensor register reads, per-tick decoding and the SMC key table. Kept apart from
+//  the IOService plumbing so the host bench runs the same code against simulated
+//  MSRs and SMN registers.
+//
+
+#include "SMCProcessorAMD.hpp"
+#include "SensorDecode.hpp"
+
+
+// 汇总键的数据类型：频率用flt(MHz)，功耗sp96，温度sp78
+static VirtualSMCValue *aggregateValue(uint8_t quantity, VirtualSMCValue *value){
+    switch (quantity) {
+        case CoreGroupStats::Clock:
+            return VirtualSMCAPI::valueWithFlt(0, value);
+        case CoreGroupStats::Power:
+            return VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp96, value);
+        default:
+            return VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, value);
+    }
+}
+
+// 创建所有SMC键，由add注册到VirtualSMC(或基准测试中的键表)
+bool SMCProcessorAMD::addSensorKeys(KeyAdder add, void *context){
+
+    bool suc = true;
+
+    // 读取CPU瓦特数
+    suc &= add(context, KeyPCPR, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp96, new EnergyPackage(this, 0)));
+    suc &= add(context, KeyPCPT, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp96, new EnergyPackage(this, 0)));
+    suc &= add(context, KeyPCTR, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp96, new EnergyPackage(this, 0)));
+    add(context, KeyVCxC(0), VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp3c, new EnergyPackage(this, 0)));
+
+    // Cpu TEMP
+    suc &= add(context, KeyTCxD(0), VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempPackage(this, 0)));
+    suc &= add(context, KeyTCxE(0), VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempPackage(this, 0)));
+    suc &= add(context, KeyTCxF(0), VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempPackage(this, 0)));
+    suc &= add(context, KeyTCxG(0), VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78));
+    suc &= add(context, KeyTCxH(0), VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempPackage(this, 0)));
+    suc &= add(context, KeyTCxJ(0), VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78));
+    suc &= add(context, KeyTCxP(0), VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempPackage(this, 0)));
+    suc &= add(context, KeyTCxp(0), VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempPackage(this, 0)));
+//    suc &= add(context, KeyTCxT(0), VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempPackage(this, 0)));
+
+    // cpu温度
+    add(context, KeyTp01, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
+    add(context, KeyTp05, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
+    add(context, KeyTp09, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
+    add(context, KeyTp0D, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
+    add(context, KeyTp0b, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
+    add(context, KeyTp0f, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
+    add(context, KeyTp0j, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
+
+    // 每核心温度/功耗/频率，只为单字符索引能表示的前36个核心创建，其余核心只体现在下面的汇总键中
+    size_t coreKeys = totalNumberOfPhysicalCores < MaxIndexCount ? totalNumberOfPhysicalCores : MaxIndexCount;
+    for(size_t core = 0; core < coreKeys; core++){
+        add(context, KeyTCxC(core), VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCoreSensor(this, coreToPackage[core], core)));
+        add(context, KeyPCxC(core), VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp96, new PowerCore(this, coreToPackage[core], core)));
+        add(context, KeyCCxC(core), VirtualSMCAPI::valueWithFlt(0, new ClockCore(this, coreToPackage[core], core)));
+    }
+    
+    // 每个CCD和每个CPU包的最大/平均/最小值，由采样器每个周期计算一次
+    for(uint8_t q = 0; q < CoreGroupStats::Count; q++){
+        for(uint8_t st = 0; st < SensorStats::Count; st++){
+            for(size_t ccd = 0; ccd < ccdCount && ccd < MaxIndexCount; ccd++)
+                add(context, KeyxDxx(q, ccd, st), aggregateValue(q, new CoreGroupValue(this, ccd, true, q, st)));
+            
+            for(size_t pkg = 0; pkg < cpuTopology.packageCount && pkg < MaxPackages; pkg++)
+                add(context, KeyxKxx(q, pkg, st), aggregateValue(q, new CoreGroupValue(this, pkg, false, q, st)));
+        }
+    }
+
+    add(context, KeyTGDD, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
+    // 核显温度
+
+    // CPU核心电压，来自SMU PM表，只有当前布局(PMTableLayouts)映射了CoreVoltage时才发布
+    const PMTableLayout *pmLayout = pmTableMap ? pmTableParser.layoutFor(pmTableVersion) : nullptr;
+    if(pmLayout && pmLayout->coreVoltage != PMTableLayout::Unmapped)
+        add(context, KeyVD0R, VirtualSMCAPI::valueWithFlt(0, new PMTableValue(this, 0, PMTableValue::CoreVoltage)));
+
+
+    // CPU电流，来自SMU PM表的TDC值
+    add(context, KeyID0R, VirtualSMCAPI::valueWithFlt(0, new PMTableValue(this, 0, PMTableValue::TdcValue)));
+
+    add(context, KeyTH0B, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
+
+    // 无对应传感器，保留为封装温度
+    add(context, KeyTW0P, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
+
+    // 分扇监控
+    add(context, KeyF0Ac, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new TempCore(this, 0)));
+
+    // 温控降频(HTC/PROCHOT)状态与计数
+    add(context, KeyHTCA, VirtualSMCAPI::valueWithFlag(false, new ThrottleValue(this, 0, ThrottleValue::Active)));
+    add(context, KeyHTCE, VirtualSMCAPI::valueWithUint32(0, new ThrottleValue(this, 0, ThrottleValue::Entries)));
+    add(context, KeyHTCT, VirtualSMCAPI::valueWithFlt(0, new ThrottleValue(this, 0, ThrottleValue::Seconds)));
+    add(context, KeyHTCL, VirtualSMCAPI::valueWithSp(0, SmcKeyTypeSp78, new ThrottleValue(this, 0, ThrottleValue::Limit)));
+
+    return suc;
+}
+
+bool SMCProcessorAMD::read_msr(uint32_t addr, uint64_t *value){
+    
+    uint32_t lo, hi;
+//    IOLog("SMCProcessorAMD lalala \n");
+    int err = rdmsr_carefully(addr, &lo, &hi);
+//    IOLog("SMCProcessorAMD rdmsr_carefully %d\n", err);
+    
+    if(!err) *value = lo | ((uint64_t)hi << 32);
+    
+    return err == 0;
+}
+
+void SMCProcessorAMD::read_smn(const uint32_t *addrs, uint32_t *values, size_t count){
+    
+    IOPCIAddressSpace space;
+    space.bits = 0x00;
+    
+    for(size_t i = 0; i < count; i++){
+        fIOPCIDevice->configWrite32(space, (UInt8)kFAMILY_17H_PCI_CONTROL_REGISTER, (UInt32)addrs[i]);
+        values[i] = fIOPCIDevice->configRead32(space, kFAMILY_17H_PCI_CONTROL_REGISTER + 4);
+    }
+}
+
+void SMCProcessorAMD::write_smn(uint32_t addr, uint32_t value){
+    
+    IOPCIAddressSpace space;
+    space.bits = 0x00;
+    
+    fIOPCIDevice->configWrite32(space, (UInt8)kFAMILY_17H_PCI_CONTROL_REGISTER, (UInt32)addr);
+    fIOPCIDevice->configWrite32(space, (UInt8)(kFAMILY_17H_PCI_CONTROL_REGISTER + 4), (UInt32)value);
+}
+
+void SMCProcessorAMD::updateClockSpeed(){
+    
+    if(!hasCapability(Capability::CoreClock))
+        return;
+    
+    uint32_t cpu_num = cpu_number();
+            
+    // Ignore hyper-threaded cores
+    uint8_t package = cpuTopology.numberToPackage[cpu_num];
+    uint8_t logical = cpuTopology.numberToLogical[cpu_num];
+    if (logical >= cpuTopology.physicalCount[package])
+        return;
+            
+    uint8_t physical = cpuTopology.numberToPhysicalUnique(cpu_num);
+            
+    uint64_t msr_value_buf = 0;
+    if(!read_msr(kMSR_HARDWARE_PSTATE_STATUS, &msr_value_buf))
+        return;
+    
+    //Convert register value to clock speed.
+    float clock = SensorDecode::coreClockMHz(msr_value_buf);
+
+    // IOLog("SMCProcessorAMD::updateClockSpeed: i am CPU %hhu, physical %hhu, %llu(%f)\n", package, physical, msr_value_buf, clock);
+
+    //Legacy user client format, GHz * 10.
+    MSR_HARDWARE_PSTATE_STATUS_perCore[physical] = (uint64_t)(clock / 100.0f);
+    CORE_CLOCK_perCore[physical] = clock;
+}
+
+void SMCProcessorAMD::updateCoreEnergy(){
+    
+    if(!hasCapability(Capability::CoreEnergy))
+        return;
+    
+    uint32_t cpu_num = cpu_number();
+    
+    // Ignore hyper-threaded cores
+    uint8_t package = cpuTopology.numberToPackage[cpu_num];
+    uint8_t logical = cpuTopology.numberToLogical[cpu_num];
+    if (logical >= cpuTopology.physicalCount[package])
+        return;
+    
+    uint8_t physical = cpuTopology.numberToPhysicalUnique(cpu_num);
+    
+    uint64_t msr_value_buf = 0;
+    if(read_msr(kMSR_CORE_ENERGY_STAT, &msr_value_buf))
+        coreEnergyRaw[physical] = (uint32_t)(msr_value_buf & 0xffffffff);
+}
+
+void SMCProcessorAMD::updatePackageTemp(){
+    
+    // Tctl, HTC status/limit and CCD temperatures in one SMN batch.
+    uint32_t addrs[2 + MaxCcds];
+    uint32_t values[2 + MaxCcds] {};
+    size_t count = 0;
+    
+    // Only registers that passed the startup probe go into the batch.
+    bool tctl = hasCapability(Capability::Tctl);
+    bool htc = hasCapability(Capability::HTC);
+    size_t ccds = hasCapability(Capability::CCDTemperature) ? ccdTemperatureCount : 0;
+    
+    if(tctl)
+        addrs[count++] = kF17H_M01H_THM_TCON_CUR_TMP;
+    size_t htcIndex = count;
+    if(htc)
+        addrs[count++] = kF17H_M01H_THM_TCON_HTC;
+    size_t ccdIndex = count;
+    for(size_t ccd = 0; ccd < ccds; ccd++)
+        addrs[count++] = ccdTemperatureBase + (uint32_t)ccdRegister[ccd] * 4;
+    
+    read_smn(addrs, values, count);
+    uint64_t time = getCurrentTimeNs();
+    
+    if(tctl)
+        PACKAGE_TEMPERATURE_perPackage[0] = SensorDecode::tctlTemperature(values[0], tempOffset);
+    
+    for(uint32_t ccd = 0; ccd < ccdCount; ccd++)
+        CCD_TEMPERATURE_perCcd[ccd] = SensorDecode::ccdTemperature(ccd < ccds ? values[ccdIndex + ccd] : 0);
+    
+    if(!htc)
+        return;
+    
+    bool active = SensorDecode::htcActive(values[htcIndex]);
+    throttleTemperatureLimit = SensorDecode::htcTemperatureLimit(values[htcIndex]);
+    
+    if(active && !throttleActive)
+        throttleEntries++;
+    if(active && lastThrottleSampleTime)
+        throttledTimeNs += time - lastThrottleSampleTime;
+    
+    throttleActive = active;
+    lastThrottleSampleTime = time;
+//    IOLog("SMCProcessorAMD::updatePackageTemp: read from pci device %d \n", (int)PACKAGE_TEMPERATURE_perPackage[0]);
+}
+
+void SMCProcessorAMD::updatePackageEnergy(){
+    
+    if(!hasCapability(Capability::PackageEnergy))
+        return;
+    
+    uint64_t time = getCurrentTimeNs();
+    
+    // A failed read is not a zero counter, keep the last sample instead of a wrap-sized spike.
+    uint64_t msr_value_buf = 0;
+    if(!read_msr(kMSR_PKG_ENERGY_STAT, &msr_value_buf))
+        return;
+    
+    uint32_t energyValue = (uint32_t)(msr_value_buf & 0xffffffff);
+    
+    uint64_t elapsed = lastUpdateTime ? time - lastUpdateTime : 0;
+    double e = SensorDecode::averagePower(energyValue, (uint32_t)lastUpdateEnergyValue, energyUnit, elapsed);
+    uniPackageEnergy = e;
+    
+    lastUpdateEnergyValue = energyValue;
+    lastUpdateTime = time;
+    
+//    IOLog("SMCProcessorAMD::updatePackageEnergy: %d \n", (int)e);
+    
+}
+
+void SMCProcessorAMD::updateCoreAggregates(uint8_t quantity, const float *perCore){
+    
+    size_t cores = totalNumberOfPhysicalCores;
+    if(cores > CPUInfo::MaxCpus)
+        cores = CPUInfo::MaxCpus;
+    
+    SensorAccumulator ccdAcc[MaxCcds];
+    SensorAccumulator pkgAcc[MaxPackages];
+    
+    for(size_t core = 0; core < cores; core++){
+        uint8_t pkg = coreToPackage[core] < MaxPackages ? coreToPackage[core] : MaxPackages - 1;
+        ccdAcc[coreToCcd[core]].add(perCore[core]);
+        pkgAcc[pkg].add(perCore[core]);
+    }
+    
+    for(size_t ccd = 0; ccd < MaxCcds; ccd++)
+        ccdAcc[ccd].store(STATS_perCcd[ccd].quantity[quantity]);
+    for(size_t pkg = 0; pkg < MaxPackages; pkg++)
+        pkgAcc[pkg].store(STATS_perPackage[pkg].quantity[quantity]);
+}
+
+void SMCProcessorAMD::updateCoreClocksAndPower(){
+    
+    uint64_t time = getCurrentTimeNs();
+    uint64_t elapsed = lastCoreUpdateTime ? time - lastCoreUpdateTime : 0;
+    lastCoreUpdateTime = time;
+    
+    size_t cores = totalNumberOfPhysicalCores;
+    if(cores > CPUInfo::MaxCpus)
+        cores = CPUInfo::MaxCpus;
+    
+    for(size_t core = 0; core < cores; core++){
+        CORE_POWER_perCore[core] = (float)SensorDecode::averagePower(coreEnergyRaw[core], lastCoreEnergyRaw[core], energyUnit, elapsed);
+        lastCoreEnergyRaw[core] = coreEnergyRaw[core];
+        
+        // The PM table has real per-core power and effective clock, prefer it where mapped.
+        uint8_t slot = corePmSlot[core];
+        if(pmTelemetry.valid && coreToPackage[core] == 0 && slot < pmTelemetry.coreSlots){
+            if(pmTelemetry.corePower[slot] == pmTelemetry.corePower[slot])
+                CORE_POWER_perCore[core] = pmTelemetry.corePower[slot];
+            if(pmTelemetry.coreEffectiveClock[slot] == pmTelemetry.coreEffectiveClock[slot])
+                CORE_CLOCK_perCore[core] = pmTelemetry.coreEffectiveClock[slot];
+        }
+    }
+    
+    updateCoreAggregates(CoreGroupStats::Clock, CORE_CLOCK_perCore);
+    updateCoreAggregates(CoreGroupStats::Power, CORE_POWER_perCore);
+}
+
+void SMCProcessorAMD::updateCoreTemperatures(){
+    
+    size_t cores = totalNumberOfPhysicalCores;
+    if(cores > CPUInfo::MaxCpus)
+        cores = CPUInfo::MaxCpus;
+    
+    for(size_t core = 0; core < cores; core++){
+        float temperature = CCD_TEMPERATURE_perCcd[coreToCcd[core]];
+        if(temperature != temperature)
+            temperature = PACKAGE_TEMPERATURE_perPackage[0];
+        
+        // The PM table has real per-core temperature, prefer it where mapped.
+        uint8_t slot = corePmSlot[core];
+        if(pmTelemetry.valid && coreToPackage[core] == 0 && slot < pmTelemetry.coreSlots
+           && pmTelemetry.coreTemperature[slot] == pmTelemetry.coreTemperature[slot])
+            temperature = pmTelemetry.coreTemperature[slot];
+        
+        CORE_TEMPERATURE_perCore[core] = temperature;
+    }
+    
+    updateCoreAggregates(CoreGroupStats::Temperature, CORE_TEMPERATURE_perCore);
+}
@@ -15,6 +15,15 @@ bool SMCProcessorAMDUserClient::start(IOService *provider){
         fProvider = OSDynamicCast(SMCProcessorAMD, provider);
     }
 
+    // 阈值事件队列
+    if(success){
+        fEventQueue = IOSharedDataQueue::withEntries(kThresholdEventQueueEntries, sizeof(ThresholdEvent));
+        if(!fEventQueue){
+            IOLog("SMCProcessorAMDUserClient::start unable to allocate event queue.\n");
+            success = false;
+        }
+    }
+
     return success;
 }
 
@@ -22,11 +31,85 @@ bool SMCProcessorAMDUserClient::start(IOService *provider){
 void SMCProcessorAMDUserClient::stop(IOService *provider){
     IOLog("SMCProcessorAMDUserClient::stop\n");
 
+    // 移除该客户端的所有订阅，之后采样器不会再访问事件队列
+    if(fProvider){
+        fProvider->unsubscribeAllThresholds(this);
+        fProvider->stopTrace(this);
+    }
+
     // 将提供者设置为null
     fProvider = nullptr;
     IOService::stop(provider);
 }
 
+void SMCProcessorAMDUserClient::free(){
+    OSSafeReleaseNULL(fEventQueue);
+    OSSafeReleaseNULL(fTraceQueue);
+    IOUserClient::free();
+}
+
+IOReturn SMCProcessorAMDUserClient::clientClose(){
+    terminate();
+    return kIOReturnSuccess;
+}
+
+IOReturn SMCProcessorAMDUserClient::clientMemoryForType(UInt32 type, IOOptionBits *options, IOMemoryDescriptor **memory){
+    IOSharedDataQueue *queue = nullptr;
+    if(type == kThresholdEventQueue)
+        queue = fEventQueue;
+    else if(type == kTraceQueue)
+        queue = fTraceQueue;
+
+    if(!queue)
+        return kIOReturnBadArgument;
+
+    IOMemoryDescriptor *descriptor = queue->getMemoryDescriptor();
+    if(!descriptor)
+        return kIOReturnNoMemory;
+
+    descriptor->retain();
+    *memory = descriptor;
+
+    return kIOReturnSuccess;
+}
+
+IOReturn SMCProcessorAMDUserClient::registerNotificationPort(mach_port_t port, UInt32 type, io_user_reference_t refCon){
+    IOSharedDataQueue *queue = (type == kTraceQueue) ? fTraceQueue : fEventQueue;
+    if(!queue)
+        return kIOReturnNotReady;
+
+    queue->setNotificationPort(port);
+    return kIOReturnSuccess;
+}
+
+void SMCProcessorAMDUserClient::enqueueThresholdEvent(const ThresholdEvent &event){
+    // 队列满时丢弃事件，采样器不能阻塞，每次溢出只记录一次日志
+    if(!fEventQueue->enqueue(const_cast<ThresholdEvent*>(&event), sizeof(event))){
+        if(fDroppedEvents++ == 0)
+            IOLog("SMCProcessorAMDUserClient::enqueueThresholdEvent: queue full, dropping events\n");
+        return;
+    }
+
+    if(fDroppedEvents){
+        IOLog("SMCProcessorAMDUserClient::enqueueThresholdEvent: queue drained, %u events were dropped\n", fDroppedEvents);
+        fDroppedEvents = 0;
+    }
+}
+
+void SMCProcessorAMDUserClient::enqueueTraceBlock(const uint8_t *block, size_t size){
+    // 客户端读取太慢时丢弃整块，块自带序号，解码端可以发现缺口；与事件队列一样每次溢出只记录一次日志
+    if(!fTraceQueue->enqueue(const_cast<uint8_t*>(block), (UInt32)size)){
+        if(fDroppedBlocks++ == 0)
+            IOLog("SMCProcessorAMDUserClient::enqueueTraceBlock: queue full, dropping blocks\n");
+        return;
+    }
+
+    if(fDroppedBlocks){
+        IOLog("SMCProcessorAMDUserClient::enqueueTraceBlock: queue drained, %u blocks were dropped\n", fDroppedBlocks);
+        fDroppedBlocks = 0;
+    }
+}
+
 // 两数相乘
 uint64_t multiply_two_numbers(uint64_t number_one, uint64_t number_two){
     uint64_t number_three = 0;
@@ -98,6 +181,116 @@ IOReturn SMCProcessorAMDUserClient::externalMethod(uint32_t selector, IOExternal
             break;
         }
 
+        case 4: {
+            // 订阅阈值事件
+            // in: sensor, direction, threshold, hysteresis (milli-units, signed), min duration (ms)
+            if(arguments->scalarInputCount < 5)
+                return kIOReturnBadArgument;
+
+            // 截断前检查范围，否则65536会变成传感器0
+            if(arguments->scalarInput[0] >= SensorId::Count || arguments->scalarInput[1] > ThresholdSpec::Below)
+                return kIOReturnBadArgument;
+
+            ThresholdSpec spec {};
+            spec.sensor = (uint16_t)arguments->scalarInput[0];
+            spec.direction = (uint8_t)arguments->scalarInput[1];
+            spec.threshold = (int64_t)arguments->scalarInput[2] * 0.001f;
+            spec.hysteresis = (int64_t)arguments->scalarInput[3] * 0.001f;
+            spec.minDurationMs = (uint32_t)arguments->scalarInput[4];
+
+            uint32_t id = fProvider->subscribeThreshold(spec, this);
+            if(!id)
+                return kIOReturnBadArgument;
+
+            arguments->scalarOutput[0] = id;
+            arguments->scalarOutputCount = 1;
+            break;
+        }
+
+        case 5: {
+            // 取消订阅
+            if(arguments->scalarInputCount < 1)
+                return kIOReturnBadArgument;
+
+            if(!fProvider->unsubscribeThreshold((uint32_t)arguments->scalarInput[0], this))
+                return kIOReturnNotFound;
+
+            arguments->scalarOutputCount = 0;
+            break;
+        }
+
+        case 6: {
+            // 温控降频状态
+            // out: active, entries, throttled time (ns), HTC temperature limit (milli °C)
+            arguments->scalarOutput[0] = fProvider->throttleActive;
+            arguments->scalarOutput[1] = fProvider->throttleEntries;
+            arguments->scalarOutput[2] = fProvider->throttledTimeNs;
+            arguments->scalarOutput[3] = (uint64_t)(fProvider->throttleTemperatureLimit * 1000.0f);
+            arguments->scalarOutputCount = 4;
+            break;
+        }
+
+        case 7: {
+            // SMU PM表数据
+            if(arguments->structureOutputSize < sizeof(PMTelemetry))
+                return kIOReturnBadArgument;
+
+            arguments->scalarOutput[0] = fProvider->pmTelemetry.valid ? fProvider->pmTelemetry.version : 0;
+            arguments->scalarOutputCount = 1;
+
+            memcpy(arguments->structureOutput, &fProvider->pmTelemetry, sizeof(PMTelemetry));
+            arguments->structureOutputSize = sizeof(PMTelemetry);
+            break;
+        }
+
+        case 8: {
+            // 每个CCX的L3命中率与缺失带宽
+            uint32_t ccxs = fProvider->l3CountersEnabled ? fProvider->ccxCount : 0;
+            if(ccxs > SMCProcessorAMD::MaxCcxs)
+                ccxs = SMCProcessorAMD::MaxCcxs;
+
+            if(arguments->structureOutputSize < ccxs * sizeof(L3Stats))
+                return kIOReturnBadArgument;
+
+            arguments->scalarOutput[0] = ccxs;
+            arguments->scalarOutputCount = 1;
+
+            memcpy(arguments->structureOutput, fProvider->L3_STATS_perCcx, ccxs * sizeof(L3Stats));
+            arguments->structureOutputSize = ccxs * sizeof(L3Stats);
+            break;
+        }
+
+        case 9: {
+            // 开始记录二进制跟踪
+            // in: samples per block (0 = 60), out: traced core count
+            uint16_t blockSamples = arguments->scalarInputCount > 0 ? (uint16_t)arguments->scalarInput[0] : 0;
+            if(!blockSamples)
+                blockSamples = 60;
+            if(blockSamples > TraceFormat::MaxBlockSamples)
+                return kIOReturnBadArgument;
+
+            if(!fTraceQueue){
+                fTraceQueue = IOSharedDataQueue::withCapacity(kTraceQueueBytes);
+                if(!fTraceQueue)
+                    return kIOReturnNoMemory;
+            }
+
+            if(!fProvider->startTrace(this, blockSamples))
+                return kIOReturnBusy;
+
+            uint32_t cores = fProvider->totalNumberOfPhysicalCores;
+            arguments->scalarOutput[0] = cores < TraceSnapshot::MaxCores ? cores : TraceSnapshot::MaxCores;
+            arguments->scalarOutputCount = 1;
+            break;
+        }
+
+        case 10: {
+            // 停止记录，未满的块会先写入队列
+            fProvider->stopTrace(this);
+            arguments->scalarOutputCount = 0;
+            break;
+        }
+
         default: {
             IOLog("SMCProcessorAMDUserClient::externalMethod: invalid method.\n");
             break;
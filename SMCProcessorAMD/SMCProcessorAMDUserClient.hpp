@@ -10,6 +10,7 @@
 
 #include <IOKit/IOService.h>
 #include <IOKit/IOUserClient.h>
+#include <IOKit/IOSharedDataQueue.h>
 #include <IOKit/IOLib.h>
 
 #include "SMCProcessorAMD.hpp"
@@ -21,16 +22,55 @@ class SMCProcessorAMDUserClient : public IOUserClient
     
       
 public:
+    /**
+     *  Memory type passed to IOConnectMapMemory to map the threshold event queue.
+     */
+    static constexpr UInt32 kThresholdEventQueue = 0;
+    
+    /**
+     *  Number of ThresholdEvent records the queue can hold before events are dropped.
+     */
+    static constexpr UInt32 kThresholdEventQueueEntries = 256;
+    
+    /**
+     *  Memory type of the trace block queue, allocated when the client starts a trace.
+     */
+    static constexpr UInt32 kTraceQueue = 1;
+    static constexpr UInt32 kTraceQueueBytes = 512 * 1024;
+    
     // IOUserClient methods
     virtual void stop(IOService* provider) override;
     virtual bool start(IOService* provider) override;
+    virtual void free() override;
+    virtual IOReturn clientClose() override;
+    
+    virtual IOReturn clientMemoryForType(UInt32 type, IOOptionBits *options, IOMemoryDescriptor **memory) override;
+    virtual IOReturn registerNotificationPort(mach_port_t port, UInt32 type, io_user_reference_t refCon) override;
+    
+    /**
+     *  Called by the sampler for every event raised by one of our subscriptions.
+     */
+    void enqueueThresholdEvent(const ThresholdEvent &event);
+    
+    /**
+     *  Called by the sampler with every encoded trace block.
+     */
+    void enqueueTraceBlock(const uint8_t *block, size_t size);
     
-
     
 protected:
     
     SMCProcessorAMD *fProvider;
     
+    IOSharedDataQueue *fEventQueue {nullptr};
+    
+    /**
+     *  Events dropped since the queue last accepted one, logged once per overflow.
+     */
+    UInt32 fDroppedEvents {0};
+    IOSharedDataQueue *fTraceQueue {nullptr};
+    UInt32 fDroppedBlocks {0};
+    
     // KPI for supporting access from both 32-bit and 64-bit user processes beginning with Mac OS X 10.5.
     virtual IOReturn externalMethod(uint32_t selector, IOExternalMethodArguments* arguments,
                                     IOExternalMethodDispatch* dispatch, OSObject* target, void* reference) override;
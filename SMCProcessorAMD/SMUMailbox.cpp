@@ -0,0 +1,121 @@
+//
+//  SMUMailbox.cpp
+//  SMCProcessorAMD
+//
+
+#include "SMUMailbox.hpp"
+
+
+/**
+ *  Known SMU interfaces, addresses and command ids after ryzen_smu.
+ */
+static const SMUProfile smuProfiles[] = {
+    { "Matisse", 0x17, 0x71, 0x71, { 0x03B10524, 0x03B10570, 0x03B10A40 }, 0x08, 0x05, 0x06 },
+    { "Vermeer", 0x19, 0x21, 0x21, { 0x03B10524, 0x03B10570, 0x03B10A40 }, 0x08, 0x05, 0x06 },
+};
+
+const SMUProfile *SMUProfile::find(uint8_t family, uint8_t model){
+    for(size_t i = 0; i < sizeof(smuProfiles) / sizeof(smuProfiles[0]); i++){
+        const SMUProfile &p = smuProfiles[i];
+        if(p.family == family && model >= p.modelFirst && model <= p.modelLast)
+            return &p;
+    }
+    return nullptr;
+}
+
+SMUMailbox::Status SMUMailbox::waitResponse(uint32_t *response){
+    for(uint32_t i = 0; i < maxPolls; i++){
+        if(!backend.read(backend.context, layout.response, response))
+            return BackendError;
+        if(*response != 0)
+            return OK;
+        if(backend.delay)
+            backend.delay(backend.context, PollDelayUs);
+    }
+    return Timeout;
+}
+
+SMUMailbox::Status SMUMailbox::send(uint32_t command, uint32_t args[ArgCount]){
+    uint32_t response = 0;
+
+    // A previous message must have completed before the mailbox is reused.
+    Status status = waitResponse(&response);
+    if(status != OK)
+        return status;
+
+    if(!backend.write(backend.context, layout.response, 0))
+        return BackendError;
+
+    for(size_t i = 0; i < ArgCount; i++){
+        if(!backend.write(backend.context, layout.args + (uint32_t)(i * 4), args[i]))
+            return BackendError;
+    }
+
+    if(!backend.write(backend.context, layout.command, command))
+        return BackendError;
+
+    status = waitResponse(&response);
+    if(status != OK)
+        return status;
+
+    switch (response) {
+        case 0x01:
+            break;
+        case 0xFE:
+            return UnknownCommand;
+        case 0xFD:
+            return RejectedPrerequisite;
+        case 0xFC:
+            return RejectedBusy;
+        default:
+            return Failed;
+    }
+
+    for(size_t i = 0; i < ArgCount; i++){
+        if(!backend.read(backend.context, layout.args + (uint32_t)(i * 4), &args[i]))
+            return BackendError;
+    }
+
+    return OK;
+}
+
+SMUMailbox::Status SMUMailbox::locatePmTable(const SMUProfile &profile, uint32_t *version, uint64_t *address){
+    *address = 0;
+
+    uint32_t args[ArgCount] {};
+    Status status = send(profile.getPmTableVersion, args);
+    if(status != OK)
+        return status;
+    *version = args[0];
+
+    // The SMU only reports a valid base address once a table has been transferred.
+    status = transferPmTable(profile);
+    if(status != OK)
+        return status;
+
+    uint32_t addressArgs[ArgCount] {};
+    status = send(profile.getDramBaseAddress, addressArgs);
+    if(status != OK)
+        return status;
+
+    *address = addressArgs[0] | ((uint64_t)addressArgs[1] << 32);
+    return OK;
+}
+
+SMUMailbox::Status SMUMailbox::transferPmTable(const SMUProfile &profile){
+    uint32_t args[ArgCount] {};
+    return send(profile.transferTableToDram, args);
+}
+
+const char *SMUMailbox::statusName(Status status){
+    switch (status) {
+        case OK:                    return "ok";
+        case Failed:                return "failed";
+        case UnknownCommand:        return "unknown command";
+        case RejectedPrerequisite:  return "rejected (prerequisite)";
+        case RejectedBusy:          return "rejected (busy)";
+        case Timeout:               return "timeout";
+        case BackendError:          return "backend error";
+    }
+    return "?";
+}
@@ -0,0 +1,114 @@
+//
+//  SMUMailbox.hpp
+//  SMCProcessorAMD
+//
+//  SMU message mailbox over SMN. Register access goes through SMNBackend
+//  so the protocol has no IOKit dependency and can run against a simulated SMU.
+//
+
+#ifndef SMUMailbox_hpp
+#define SMUMailbox_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ *  SMN register access used by the mailbox.
+ */
+struct SMNBackend {
+    void *context;
+    bool (*read)(void *context, uint32_t addr, uint32_t *value);
+    bool (*write)(void *context, uint32_t addr, uint32_t value);
+
+    /**
+     *  Optional, called between response polls.
+     */
+    void (*delay)(void *context, uint32_t us);
+};
+
+
+/**
+ *  SMN addresses of one mailbox (command, response, first argument).
+ */
+struct SMUMailboxLayout {
+    uint32_t command;
+    uint32_t response;
+    uint32_t args;
+};
+
+
+/**
+ *  Mailbox and PM table commands of one SMU generation.
+ */
+struct SMUProfile {
+    const char *name;
+    uint8_t family;
+    uint8_t modelFirst;
+    uint8_t modelLast;
+    SMUMailboxLayout rsmu;
+    uint32_t getPmTableVersion;
+    uint32_t transferTableToDram;
+    uint32_t getDramBaseAddress;
+
+    /**
+     *  Profile for a CPU, nullptr if the SMU interface is not known.
+     */
+    static const SMUProfile *find(uint8_t family, uint8_t model);
+};
+
+
+class SMUMailbox {
+public:
+    static constexpr size_t ArgCount = 6;
+    static constexpr uint32_t DefaultPolls = 8192;
+    static constexpr uint32_t PollDelayUs = 10;
+
+    /**
+     *  Poll budget for messages sent from the sampling timer, 2 ms per response wait.
+     *  A busy SMU is retried on the next tick instead of stalling the work loop.
+     */
+    static constexpr uint32_t TickPolls = 200;
+
+    enum Status : uint8_t {
+        OK,
+        Failed,
+        UnknownCommand,
+        RejectedPrerequisite,
+        RejectedBusy,
+        Timeout,
+        BackendError,
+    };
+
+    SMUMailbox(const SMNBackend &backend, const SMUMailboxLayout &layout, uint32_t maxPolls = DefaultPolls) :
+        backend(backend), layout(layout), maxPolls(maxPolls) {}
+
+    /**
+     *  Sends one message. args holds the arguments on entry and the SMU reply on success.
+     */
+    Status send(uint32_t command, uint32_t args[ArgCount]);
+
+    /**
+     *  PM table setup: reads the table version, transfers a first table and returns its DRAM base address.
+     *  address is 0 if the SMU did not report one.
+     */
+    Status locatePmTable(const SMUProfile &profile, uint32_t *version, uint64_t *address);
+
+    /**
+     *  Asks the SMU to refresh the table at the address returned by locatePmTable().
+     */
+    Status transferPmTable(const SMUProfile &profile);
+
+    void setMaxPolls(uint32_t polls) { maxPolls = polls; }
+
+    static const char *statusName(Status status);
+
+private:
+    SMNBackend backend;
+    SMUMailboxLayout layout;
+    uint32_t maxPolls;
+
+    Status waitResponse(uint32_t *response);
+};
+
+#endif /* SMUMailbox_hpp */
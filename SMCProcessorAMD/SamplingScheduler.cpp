@@ -0,0 +1,55 @@
+//
+//  SamplingScheduler.cpp
+//  SMCProcessorAMD
+//
+
+#include "SamplingScheduler.hpp"
+
+
+void SamplingScheduler::setPeriod(uint8_t group, uint32_t period){
+    if(group >= MaxGroups)
+        return;
+
+    if(period && period < MinPeriodMs)
+        period = MinPeriodMs;
+    else if(period > MaxPeriodMs)
+        period = MaxPeriodMs;
+
+    periodMs[group] = period;
+    deadlineNs[group] = period ? deadlineNs[group] : Never;
+}
+
+void SamplingScheduler::start(uint64_t nowNs){
+    for(size_t i = 0; i < MaxGroups; i++)
+        deadlineNs[i] = periodMs[i] ? nowNs + periodMs[i] * 1000000ULL : Never;
+}
+
+uint32_t SamplingScheduler::collectDue(uint64_t nowNs){
+    uint32_t due = 0;
+    wakeupCount++;
+
+    for(size_t i = 0; i < MaxGroups; i++){
+        if(!periodMs[i] || deadlineNs[i] > nowNs + CoalesceNs)
+            continue;
+
+        due |= 1u << i;
+
+        uint64_t period = periodMs[i] * 1000000ULL;
+        deadlineNs[i] += period;
+
+        // Fell behind (sleep, long rendezvous), do not try to catch up.
+        if(deadlineNs[i] <= nowNs)
+            deadlineNs[i] = nowNs + period;
+    }
+
+    return due;
+}
+
+uint64_t SamplingScheduler::nextDeadline() const {
+    uint64_t next = Never;
+    for(size_t i = 0; i < MaxGroups; i++){
+        if(periodMs[i] && deadlineNs[i] < next)
+            next = deadlineNs[i];
+    }
+    return next;
+}
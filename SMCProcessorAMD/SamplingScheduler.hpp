@@ -0,0 +1,86 @@
+//
+//  SamplingScheduler.hpp
+//  SMCProcessorAMD
+//
+//  Per sensor-group sampling periods multiplexed onto one timer.
+//  No IOKit dependency, time is passed in by the caller.
+//
+
+#ifndef SamplingScheduler_hpp
+#define SamplingScheduler_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ *  Sensor groups sampled by the timer, each with its own period.
+ */
+namespace SamplingGroup {
+    enum : uint8_t {
+        Temperature,    // package and CCD temperature over SMN
+        PackagePower,   // package energy counter
+        CoreClocks,     // per-core clock and energy, needs a cross-CPU rendezvous
+        PMTable,        // SMU PM table transfer
+        Count
+    };
+
+    static constexpr uint32_t bit(uint8_t group) { return 1u << group; }
+}
+
+
+class SamplingScheduler {
+public:
+    static constexpr size_t MaxGroups = 32;
+
+    /**
+     *  Shortest accepted period, protects the machine from a bad Info.plist.
+     */
+    static constexpr uint32_t MinPeriodMs = 50;
+
+    /**
+     *  Longest accepted period, keeps the timer delay within the 32 bit microseconds of setTimeoutUS.
+     */
+    static constexpr uint32_t MaxPeriodMs = 3600000;
+
+    /**
+     *  Groups due within this window of a wakeup are run in it as well.
+     */
+    static constexpr uint64_t CoalesceNs = 5000000;
+
+    static constexpr uint64_t Never = UINT64_MAX;
+
+    /**
+     *  A period of 0 disables the group, others are clamped to MinPeriodMs..MaxPeriodMs.
+     */
+    void setPeriod(uint8_t group, uint32_t periodMs);
+    uint32_t period(uint8_t group) const { return group < MaxGroups ? periodMs[group] : 0; }
+
+    /**
+     *  Schedules the first run of every enabled group one period after nowNs.
+     */
+    void start(uint64_t nowNs);
+
+    /**
+     *  Returns the mask of groups to sample at nowNs and moves their deadlines forward.
+     *  A group that missed several periods runs once and restarts from nowNs.
+     */
+    uint32_t collectDue(uint64_t nowNs);
+
+    /**
+     *  Earliest deadline over all enabled groups, Never if none is enabled.
+     */
+    uint64_t nextDeadline() const;
+
+    /**
+     *  Number of collectDue calls, i.e. timer wakeups.
+     */
+    uint64_t wakeups() const { return wakeupCount; }
+
+private:
+    uint32_t periodMs[MaxGroups] {};
+    uint64_t deadlineNs[MaxGroups] {};
+    uint64_t wakeupCount {0};
+};
+
+#endif /* SamplingScheduler_hpp */
@@ -0,0 +1,76 @@
+//
+//  SensorDecode.hpp
+//  SMCProcessorAMD
+//
+//  Register value to physical unit conversions used on every tick.
+//  Header only and free of IOKit so the same code can be built on the host.
+//
+
+#ifndef SensorDecode_hpp
+#define SensorDecode_hpp
+
+#include <stdint.h>
+
+
+namespace SensorDecode {
+    /**
+     *  MSRC001_0293 (hardware P-state status) to MHz.
+     *  CurCpuDfsId [13:8], CurCpuFid [7:0], clock = Fid * 200 / DfsId.
+     */
+    inline float coreClockMHz(uint64_t pstateStatus) {
+        uint32_t dfs = (uint32_t)(pstateStatus >> 8) & 0x3f;
+        uint32_t fid = (uint32_t)pstateStatus & 0xff;
+        return dfs ? (float)fid * 200.0f / (float)dfs : 0.0f;
+    }
+
+    /**
+     *  THM_TCON_CUR_TMP to °C. CurTmp [31:21] is in 0.125 °C steps,
+     *  bit 19 selects the range that reads 49 °C high. tctlOffset is the per-model Tctl bias.
+     */
+    inline float tctlTemperature(uint32_t raw, float tctlOffset) {
+        float t = (float)(raw >> 21) * 0.125f - tctlOffset;
+        if (raw & 0x80000)
+            t -= 49.0f;
+        return t;
+    }
+
+    /**
+     *  Per-CCD temperature register to °C, NaN when the valid bit [11] is clear.
+     */
+    inline float ccdTemperature(uint32_t raw) {
+        return (raw & 0x800) ? (float)(raw & 0x7ff) * 0.125f - 49.0f : __builtin_nanf("");
+    }
+
+    /**
+     *  THM_TCON_HTC: HtcAct [4] is set while hardware thermal control (Tctl limit or PROCHOT) throttles.
+     */
+    inline bool htcActive(uint32_t raw) {
+        return (raw & 0x10) != 0;
+    }
+
+    /**
+     *  THM_TCON_HTC: HtcTmpLmt [22:16] in 0.5 °C steps above 52 °C.
+     */
+    inline float htcTemperatureLimit(uint32_t raw) {
+        return 52.0f + (float)((raw >> 16) & 0x7f) * 0.5f;
+    }
+
+    /**
+     *  Joules per energy counter tick, ESU is MSR_PWR_UNIT [12:8].
+     */
+    inline double energyUnitJoules(uint64_t powerUnit) {
+        return 1.0 / (double)(1ULL << ((powerUnit >> 8) & 0x1f));
+    }
+
+    /**
+     *  Average power between two reads of a 32 bit energy counter, wrap safe.
+     */
+    inline double averagePower(uint32_t now, uint32_t last, double unitJoules, uint64_t elapsedNs) {
+        if (elapsedNs == 0)
+            return 0.0;
+        uint32_t delta = now - last;
+        return unitJoules * delta * 1000000000.0 / (double)elapsedNs;
+    }
+}
+
+#endif /* SensorDecode_hpp */
@@ -0,0 +1,157 @@
+//
+//  SensorEvents.cpp
+//  SMCProcessorAMD
+//
+
+#include "SensorEvents.hpp"
+
+
+ThresholdEvaluator::ThresholdEvaluator(){
+    for(size_t i = 0; i < MaxSubscriptions; i++){
+        slots[i] = {};
+        slots[i].next = (i + 1 < MaxSubscriptions) ? (int16_t)(i + 1) : None;
+    }
+    freeHead = 0;
+
+    for(size_t i = 0; i < SensorId::Count; i++){
+        sensorHead[i] = None;
+        activePosition[i] = None;
+    }
+}
+
+uint32_t ThresholdEvaluator::subscribe(const ThresholdSpec &spec, void *owner){
+    if(spec.sensor >= SensorId::Count || spec.direction > ThresholdSpec::Below)
+        return 0;
+    if(spec.threshold != spec.threshold || !(spec.hysteresis >= 0.0f))
+        return 0;
+    if(freeHead == None)
+        return 0;
+
+    int16_t index = freeHead;
+    Slot &slot = slots[index];
+    freeHead = slot.next;
+
+    // Slot index lives in the low byte, the rest makes stale ids unusable after reuse.
+    sequence = (sequence + 1) & 0xffffff;
+    if(sequence == 0) sequence = 1;
+
+    slot.spec = spec;
+    slot.owner = owner;
+    slot.pendingSinceNs = 0;
+    slot.id = (sequence << 8) | (uint32_t)(index + 1);
+    slot.state = StateIdle;
+    slot.inUse = true;
+
+    // Push front on the sensor chain.
+    uint16_t sensor = spec.sensor;
+    slot.prev = None;
+    slot.next = sensorHead[sensor];
+    if(slot.next != None) slots[slot.next].prev = index;
+    sensorHead[sensor] = index;
+
+    if(activePosition[sensor] == None){
+        activePosition[sensor] = activeSensorCount;
+        activeSensors[activeSensorCount++] = sensor;
+    }
+
+    used++;
+    return slot.id;
+}
+
+void ThresholdEvaluator::release(int16_t index){
+    Slot &slot = slots[index];
+    uint16_t sensor = slot.spec.sensor;
+
+    if(slot.prev != None) slots[slot.prev].next = slot.next;
+    else sensorHead[sensor] = slot.next;
+    if(slot.next != None) slots[slot.next].prev = slot.prev;
+
+    // Last rule on this sensor, swap it out of the dense list.
+    if(sensorHead[sensor] == None){
+        int16_t pos = activePosition[sensor];
+        uint16_t moved = activeSensors[--activeSensorCount];
+        activeSensors[pos] = moved;
+        activePosition[moved] = pos;
+        activePosition[sensor] = None;
+    }
+
+    slot = {};
+    slot.next = freeHead;
+    freeHead = index;
+    used--;
+}
+
+bool ThresholdEvaluator::unsubscribe(uint32_t id, void *owner){
+    uint32_t index = (id & 0xff);
+    if(index == 0 || index > MaxSubscriptions)
+        return false;
+
+    index--;
+    if(!slots[index].inUse || slots[index].id != id || slots[index].owner != owner)
+        return false;
+
+    release((int16_t)index);
+    return true;
+}
+
+void ThresholdEvaluator::unsubscribeAll(void *owner){
+    for(size_t i = 0; i < MaxSubscriptions; i++){
+        if(slots[i].inUse && slots[i].owner == owner)
+            release((int16_t)i);
+    }
+}
+
+void ThresholdEvaluator::evaluate(const float *values, uint64_t nowNs, Sink sink, void *context){
+    for(uint16_t a = 0; a < activeSensorCount; a++){
+        uint16_t sensor = activeSensors[a];
+        float value = values[sensor];
+
+        // Sensor not sampled this tick, keep every rule where it is.
+        if(value != value)
+            continue;
+
+        for(int16_t i = sensorHead[sensor]; i != None; i = slots[i].next){
+            Slot &slot = slots[i];
+
+            // Mirror Below rules so a single comparison path handles both.
+            bool below = slot.spec.direction == ThresholdSpec::Below;
+            float v = below ? -value : value;
+            float limit = below ? -slot.spec.threshold : slot.spec.threshold;
+
+            uint8_t emit = 0xff;
+            switch (slot.state) {
+                case StateIdle:
+                    if(v <= limit) break;
+                    slot.pendingSinceNs = nowNs;
+                    slot.state = StatePending;
+                    // fall through
+                case StatePending:
+                    if(v <= limit){
+                        slot.state = StateIdle;
+                    } else if(nowNs - slot.pendingSinceNs >= slot.spec.minDurationMs * 1000000ULL){
+                        slot.state = StateActive;
+                        emit = ThresholdEvent::Raised;
+                    }
+                    break;
+                case StateActive:
+                    if(v <= limit - slot.spec.hysteresis){
+                        slot.state = StateIdle;
+                        emit = ThresholdEvent::Cleared;
+                    }
+                    break;
+            }
+
+            if(emit != 0xff && sink){
+                ThresholdEvent event {};
+                event.timestampNs = nowNs;
+                event.subscription = slot.id;
+                event.sensor = sensor;
+                event.kind = emit;
+                event.direction = slot.spec.direction;
+                event.value = value;
+                event.threshold = slot.spec.threshold;
+                sink(slot.owner, event, context);
+            }
+        }
+    }
+}
@@ -0,0 +1,138 @@
+//
+//  SensorEvents.hpp
+//  SMCProcessorAMD
+//
+//  Threshold subscriptions evaluated by the sampler. Kept free of IOKit so the
+//  rule engine can be compiled and exercised outside of the kernel.
+//
+
+#ifndef SensorEvents_hpp
+#define SensorEvents_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ *  Flat index of every sensor the sampler publishes.
+ *  Package sensors live below CoreClockBase, per-core sensors follow it.
+ *  These values are part of the user client ABI, never renumber them.
+ */
+namespace SensorId {
+    enum : uint16_t {
+        PackageTemperature = 0,     // °C
+        PackagePower       = 1,     // W
+        ThrottleActive     = 2,     // 1 while HTC/PROCHOT throttles the package, else 0
+        CoreClockBase      = 16,    // MHz, one entry per physical core
+    };
+
+    static constexpr uint16_t MaxCores = 128;
+    static constexpr uint16_t Count = CoreClockBase + MaxCores;
+}
+
+
+/**
+ *  A client supplied threshold rule.
+ *  An Above rule raises once the value stays above threshold for minDurationMs
+ *  and clears once it drops to threshold - hysteresis. Below rules are mirrored.
+ */
+struct ThresholdSpec {
+    enum : uint8_t {
+        Above = 0,
+        Below = 1,
+    };
+
+    uint16_t sensor;
+    uint8_t direction;
+    float threshold;
+    float hysteresis;
+    uint32_t minDurationMs;
+};
+
+
+/**
+ *  Compact record pushed to the client event queue.
+ */
+struct ThresholdEvent {
+    enum : uint8_t {
+        Raised = 0,
+        Cleared = 1,
+    };
+
+    uint64_t timestampNs;
+    uint32_t subscription;
+    uint16_t sensor;
+    uint8_t kind;
+    uint8_t direction;
+    float value;
+    float threshold;
+};
+
+
+/**
+ *  Subscription table indexed per sensor, so a tick only visits sensors that
+ *  actually have subscribers and only the rules attached to them.
+ *  Not thread safe, the owner serialises access.
+ */
+class ThresholdEvaluator {
+public:
+    static constexpr size_t MaxSubscriptions = 128;
+
+    /**
+     *  Receives every event produced by evaluate().
+     */
+    using Sink = void (*)(void *owner, const ThresholdEvent &event, void *context);
+
+    ThresholdEvaluator();
+
+    /**
+     *  Returns a non-zero subscription id, or 0 if the rule is invalid or the table is full.
+     */
+    uint32_t subscribe(const ThresholdSpec &spec, void *owner);
+    bool unsubscribe(uint32_t id, void *owner);
+    void unsubscribeAll(void *owner);
+
+    /**
+     *  Runs every rule once against values[SensorId::Count]. NaN values are treated as unavailable.
+     */
+    void evaluate(const float *values, uint64_t nowNs, Sink sink, void *context);
+
+    size_t subscriptionCount() const { return used; }
+
+private:
+    enum : uint8_t {
+        StateIdle,
+        StatePending,
+        StateActive,
+    };
+
+    static constexpr int16_t None = -1;
+
+    struct Slot {
+        ThresholdSpec spec;
+        void *owner;
+        uint64_t pendingSinceNs;
+        uint32_t id;
+        int16_t next;
+        int16_t prev;
+        uint8_t state;
+        bool inUse;
+    };
+
+    Slot slots[MaxSubscriptions];
+    int16_t freeHead {None};
+    size_t used {0};
+    uint32_t sequence {0};
+
+    /**
+     *  Per-sensor rule chains plus a dense list of sensors that have any rule.
+     */
+    int16_t sensorHead[SensorId::Count];
+    uint16_t activeSensors[SensorId::Count];
+    int16_t activePosition[SensorId::Count];
+    uint16_t activeSensorCount {0};
+
+    void release(int16_t index);
+};
+
+#endif /* SensorEvents_hpp */
@@ -0,0 +1,242 @@
+//
+//  TraceFormat.cpp
+//  SMCProcessorAMD
+//
+
+#include "TraceFormat.hpp"
+
+
+static inline uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static inline uint8_t *putVarint(uint8_t *p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static inline bool getVarint(const uint8_t *&p, const uint8_t *end, uint64_t *v) {
+    uint64_t result = 0;
+    for (uint32_t shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t b = *p++;
+        result |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *v = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline void putLE(uint8_t *p, uint64_t v, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++)
+        p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static inline uint64_t getLE(const uint8_t *p, size_t bytes) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < bytes; i++)
+        v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+static inline int32_t quantize(float v, float scale) {
+    if (v != v)
+        return TraceFormat::Missing;
+    float q = v * scale;
+    if (q >= 2147483647.0f)
+        return INT32_MAX;
+    if (q <= -2147483647.0f)
+        return -INT32_MAX;
+    return (int32_t)(q < 0 ? q - 0.5f : q + 0.5f);
+}
+
+static inline float dequantize(int32_t v, float scale) {
+    return v == TraceFormat::Missing ? __builtin_nanf("") : (float)v / scale;
+}
+
+/**
+ *  Scale of every column group, see the quantisation note in the header.
+ */
+static constexpr float TemperatureScale = 100.0f;
+static constexpr float PowerScale = 1000.0f;
+static constexpr float ClockScale = 1.0f;
+
+
+size_t TraceFormat::findBlock(const uint8_t *data, size_t size) {
+    for (size_t offset = 0; offset + 4 <= size; offset++) {
+        if (getLE(data + offset, 4) == Magic)
+            return offset;
+    }
+    return size;
+}
+
+
+bool TraceEncoder::configure(uint16_t cores, uint16_t blockSamples) {
+    if (cores == 0 || cores > TraceSnapshot::MaxCores)
+        return false;
+    if (blockSamples == 0 || blockSamples > TraceFormat::MaxBlockSamples)
+        return false;
+
+    this->cores = cores;
+    samplesPerBlock = blockSamples;
+    samples = 0;
+    sequence = 0;
+    return true;
+}
+
+bool TraceEncoder::append(const TraceSnapshot &snapshot) {
+    if (samples >= samplesPerBlock)
+        return true;
+
+    uint16_t n = samples++;
+    timestamps[n] = snapshot.timestampNs;
+
+    values[1][n] = quantize(snapshot.packageTemperature, TemperatureScale);
+    values[2][n] = quantize(snapshot.packagePower, PowerScale);
+    values[3][n] = snapshot.throttleActive;
+
+    const size_t base = TraceFormat::PackageColumns;
+    for (uint16_t core = 0; core < cores; core++) {
+        bool present = core < snapshot.coreCount;
+        values[base + core][n] = present ? quantize(snapshot.coreClock[core], ClockScale) : TraceFormat::Missing;
+        values[base + cores + core][n] = present ? quantize(snapshot.corePower[core], PowerScale) : TraceFormat::Missing;
+        values[base + 2 * cores + core][n] = present ? quantize(snapshot.coreTemperature[core], TemperatureScale) : TraceFormat::Missing;
+    }
+
+    return samples >= samplesPerBlock;
+}
+
+size_t TraceEncoder::flush(uint8_t *out, size_t capacity) {
+    if (samples == 0 || capacity < TraceFormat::maxBlockSize(cores, samples))
+        return 0;
+
+    uint8_t *p = out + TraceFormat::HeaderSize;
+
+    // Timestamps are regular, so the second difference is almost always 0.
+    int64_t lastOffset = 0;
+    int64_t lastDelta = 0;
+    for (uint16_t n = 1; n < samples; n++) {
+        int64_t offset = (int64_t)((timestamps[n] - timestamps[0]) / 1000);
+        int64_t delta = offset - lastOffset;
+        p = putVarint(p, zigzag(delta - lastDelta));
+        lastOffset = offset;
+        lastDelta = delta;
+    }
+
+    size_t columns = TraceFormat::columnCount(cores);
+    for (size_t column = 1; column < columns; column++) {
+        int64_t last = 0;
+        for (uint16_t n = 0; n < samples; n++) {
+            p = putVarint(p, zigzag((int64_t)values[column][n] - last));
+            last = values[column][n];
+        }
+    }
+
+    size_t payload = (size_t)(p - out) - TraceFormat::HeaderSize;
+
+    putLE(out, TraceFormat::Magic, 4);
+    putLE(out + 4, TraceFormat::Version, 2);
+    putLE(out + 6, cores, 2);
+    putLE(out + 8, samples, 2);
+    putLE(out + 10, 0, 2);
+    putLE(out + 12, sequence, 4);
+    putLE(out + 16, payload, 4);
+    putLE(out + 20, timestamps[0], 8);
+
+    sequence++;
+    samples = 0;
+    return TraceFormat::HeaderSize + payload;
+}
+
+
+TraceDecoder::Status TraceDecoder::decode(const uint8_t *data, size_t size, size_t *consumed) {
+    if (size < TraceFormat::HeaderSize)
+        return NeedMoreData;
+    if (getLE(data, 4) != TraceFormat::Magic)
+        return BadMagic;
+    if (getLE(data + 4, 2) != TraceFormat::Version)
+        return BadVersion;
+
+    uint16_t blockCores = (uint16_t)getLE(data + 6, 2);
+    uint16_t blockSamples = (uint16_t)getLE(data + 8, 2);
+    uint32_t payload = (uint32_t)getLE(data + 16, 4);
+
+    if (blockCores == 0 || blockCores > TraceSnapshot::MaxCores ||
+        blockSamples == 0 || blockSamples > TraceFormat::MaxBlockSamples)
+        return Corrupt;
+    if (size - TraceFormat::HeaderSize < payload)
+        return NeedMoreData;
+
+    const uint8_t *p = data + TraceFormat::HeaderSize;
+    const uint8_t *end = p + payload;
+    uint64_t raw;
+
+    uint64_t first = getLE(data + 20, 8);
+    int64_t offset = 0;
+    int64_t delta = 0;
+    timestamps[0] = first;
+    for (uint16_t n = 1; n < blockSamples; n++) {
+        if (!getVarint(p, end, &raw))
+            return Corrupt;
+        delta += unzigzag(raw);
+        offset += delta;
+        timestamps[n] = first + (uint64_t)offset * 1000;
+    }
+
+    size_t columns = TraceFormat::columnCount(blockCores);
+    for (size_t column = 1; column < columns; column++) {
+        int64_t value = 0;
+        for (uint16_t n = 0; n < blockSamples; n++) {
+            if (!getVarint(p, end, &raw))
+                return Corrupt;
+            value += unzigzag(raw);
+            if (value < INT32_MIN || value > INT32_MAX)
+                return Corrupt;
+            values[column][n] = (int32_t)value;
+        }
+    }
+
+    if (p != end)
+        return Corrupt;
+
+    cores = blockCores;
+    samples = blockSamples;
+    sequence = (uint32_t)getLE(data + 12, 4);
+    *consumed = TraceFormat::HeaderSize + payload;
+    return OK;
+}
+
+void TraceDecoder::snapshot(uint16_t index, TraceSnapshot &out) const {
+    out.timestampNs = timestamps[index];
+    out.packageTemperature = dequantize(values[1][index], TemperatureScale);
+    out.packagePower = dequantize(values[2][index], PowerScale);
+    out.throttleActive = (uint8_t)values[3][index];
+    out.coreCount = cores;
+
+    const size_t base = TraceFormat::PackageColumns;
+    for (uint16_t core = 0; core < cores; core++) {
+        out.coreClock[core] = dequantize(values[base + core][index], ClockScale);
+        out.corePower[core] = dequantize(values[base + cores + core][index], PowerScale);
+        out.coreTemperature[core] = dequantize(values[base + 2 * cores + core][index], TemperatureScale);
+    }
+}
+
+const char *TraceDecoder::statusName(Status status) {
+    switch (status) {
+        case OK:            return "ok";
+        case NeedMoreData:  return "truncated block";
+        case BadMagic:      return "bad magic";
+        case BadVersion:    return "unsupported version";
+        case Corrupt:       return "corrupt block";
+    }
+    return "?";
+}
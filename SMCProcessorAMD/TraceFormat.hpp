@@ -0,0 +1,157 @@
+//
+//  TraceFormat.hpp
+//  SMCProcessorAMD
+//
+//  Compact binary trace of sampler snapshots. Shared by the kext, which encodes,
+//  and the host tools, which decode, so it has no IOKit or libc++ dependency.
+//
+//  A trace is a sequence of self-contained blocks:
+//
+//      header   (HeaderSize bytes, little endian)
+//          u32 magic 'SPTR', u16 version, u16 core count, u16 sample count,
+//          u16 reserved, u32 block sequence, u32 payload bytes, u64 first timestamp (ns)
+//      payload  one column after the other, every value a zigzag varint
+//          timestamp (µs since the header timestamp, delta of delta)
+//          package temperature, package power, throttle
+//          core clock[cores], core power[cores], core temperature[cores]
+//
+//  The first sample of every column is stored absolute and the rest as deltas,
+//  so every block is a keyframe and a reader can seek to any block boundary.
+//
+
+#ifndef TraceFormat_hpp
+#define TraceFormat_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ *  One sampler snapshot, the unit the trace records.
+ */
+struct TraceSnapshot {
+    static constexpr uint16_t MaxCores = 128;
+
+    uint64_t timestampNs;
+    float packageTemperature;   // °C
+    float packagePower;         // W
+    uint8_t throttleActive;
+    uint16_t coreCount;
+    float coreClock[MaxCores];          // MHz
+    float corePower[MaxCores];          // W
+    float coreTemperature[MaxCores];    // °C
+};
+
+
+namespace TraceFormat {
+    static constexpr uint32_t Magic = 0x52545053;    // "SPTR"
+    static constexpr uint16_t Version = 1;
+    static constexpr size_t HeaderSize = 28;
+    static constexpr uint16_t MaxBlockSamples = 64;
+
+    /**
+     *  Columns besides the per-core ones: timestamp, package temperature, package power, throttle.
+     */
+    static constexpr size_t PackageColumns = 4;
+    static constexpr size_t MaxColumns = PackageColumns + 3 * TraceSnapshot::MaxCores;
+
+    /**
+     *  Quantisation: temperatures in 0.01 °C, power in mW, clocks in MHz.
+     *  NaN is stored as Missing.
+     */
+    static constexpr int32_t Missing = INT32_MIN;
+
+    inline size_t columnCount(uint16_t cores) {
+        return PackageColumns + 3 * (size_t)cores;
+    }
+
+    /**
+     *  Worst case encoded size of a block, every varint at its 10 byte maximum.
+     */
+    inline size_t maxBlockSize(uint16_t cores, uint16_t samples) {
+        return HeaderSize + columnCount(cores) * samples * 10;
+    }
+
+    /**
+     *  Offset of the first block header at or after data, or size if there is none.
+     *  Used to resynchronise after a truncated or damaged block.
+     */
+    size_t findBlock(const uint8_t *data, size_t size);
+}
+
+
+/**
+ *  Buffers snapshots and encodes them into one block per blockSamples snapshots.
+ */
+class TraceEncoder {
+public:
+    /**
+     *  Returns false if cores or blockSamples are out of range.
+     */
+    bool configure(uint16_t cores, uint16_t blockSamples);
+
+    /**
+     *  Adds a snapshot, returns true once a full block is buffered and flush() should be called.
+     */
+    bool append(const TraceSnapshot &snapshot);
+
+    /**
+     *  Encodes the buffered snapshots into out and empties the buffer.
+     *  Returns the block size, or 0 if nothing is buffered or capacity is too small.
+     */
+    size_t flush(uint8_t *out, size_t capacity);
+
+    uint16_t coreCount() const { return cores; }
+    uint16_t blockSamples() const { return samplesPerBlock; }
+    uint16_t pendingSamples() const { return samples; }
+
+private:
+    uint16_t cores {0};
+    uint16_t samplesPerBlock {0};
+    uint16_t samples {0};
+    uint32_t sequence {0};
+
+    uint64_t timestamps[TraceFormat::MaxBlockSamples];
+    int32_t values[TraceFormat::MaxColumns][TraceFormat::MaxBlockSamples];
+};
+
+
+/**
+ *  Decodes one block at a time, snapshots stay available until the next decode().
+ */
+class TraceDecoder {
+public:
+    enum Status : uint8_t {
+        OK,
+        NeedMoreData,
+        BadMagic,
+        BadVersion,
+        Corrupt,
+    };
+
+    /**
+     *  Decodes the block at data. On OK *consumed is the block size.
+     */
+    Status decode(const uint8_t *data, size_t size, size_t *consumed);
+
+    uint16_t coreCount() const { return cores; }
+    uint16_t sampleCount() const { return samples; }
+    uint32_t blockSequence() const { return sequence; }
+
+    /**
+     *  Snapshot index of the last decoded block, index < sampleCount().
+     */
+    void snapshot(uint16_t index, TraceSnapshot &out) const;
+
+    static const char *statusName(Status status);
+
+private:
+    uint16_t cores {0};
+    uint16_t samples {0};
+    uint32_t sequence {0};
+
+    uint64_t timestamps[TraceFormat::MaxBlockSamples];
+    int32_t values[TraceFormat::MaxColumns][TraceFormat::MaxBlockSamples];
+};
+
+#endif /* TraceFormat_hpp */
@@ -0,0 +1,183 @@
+//
+//  CapabilitiesTests.cpp
+//  SMCProcessorAMD
+//
+
+#include "Capabilities.hpp"
+#include "TestHarness.hpp"
+
+#include <cstring>
+#include <map>
+#include <set>
+
+
+namespace {
+    /**
+     *  Register file with injectable faults. Unknown registers fault, like a missing MSR.
+     */
+    struct FaultyRegisters {
+        std::map<uint32_t, uint64_t> msr;
+        std::map<uint32_t, uint32_t> smn;
+        std::set<uint32_t> faults;
+        std::map<uint32_t, unsigned> reads;
+
+        RegisterBackend backend() {
+            RegisterBackend b {};
+            b.context = this;
+            b.readMsr = [](void *context, uint32_t addr, uint64_t *value) {
+                auto regs = static_cast<FaultyRegisters*>(context);
+                regs->reads[addr]++;
+                auto it = regs->msr.find(addr);
+                if (it == regs->msr.end() || regs->faults.count(addr))
+                    return false;
+                *value = it->second;
+                return true;
+            };
+            b.readSmn = [](void *context, uint32_t addr, uint32_t *value) {
+                auto regs = static_cast<FaultyRegisters*>(context);
+                regs->reads[addr]++;
+                auto it = regs->smn.find(addr);
+                if (it == regs->smn.end() || regs->faults.count(addr))
+                    return false;
+                *value = it->second;
+                return true;
+            };
+            return b;
+        }
+    };
+
+    constexpr uint32_t PwrUnit = 0xC0010299;
+    constexpr uint32_t PkgEnergy = 0xC001029B;
+    constexpr uint32_t L3Cfg = 0xC0010230;
+    constexpr uint32_t L3Ctr = 0xC0010231;
+    constexpr uint32_t Tctl = 0x00059800;
+    constexpr uint32_t SmuCommand = 0x03B10524;
+    constexpr uint32_t SmuResponse = 0x03B10570;
+    constexpr uint32_t SmuArgs = 0x03B10A40;
+
+    bool nonZero(uint64_t value) { return value != 0; }
+
+    /**
+     *  A subset of the table SMCProcessorAMD::probeCapabilities builds.
+     */
+    const RegisterProbe Probes[] = {
+        { Capability::PowerUnit, RegisterProbe::MSR, PwrUnit, nullptr },
+        { Capability::PackageEnergy, RegisterProbe::MSR, PkgEnergy, nullptr },
+        { Capability::L3Counters, RegisterProbe::MSR, L3Cfg, nullptr },
+        { Capability::L3Counters, RegisterProbe::MSR, L3Ctr, nullptr },
+        { Capability::Tctl, RegisterProbe::SMN, Tctl, nonZero },
+        { Capability::SMU, RegisterProbe::SMN, SmuCommand, nullptr },
+        { Capability::SMU, RegisterProbe::SMN, SmuResponse, nonZero },
+        { Capability::SMU, RegisterProbe::SMN, SmuArgs, nullptr },
+    };
+    constexpr size_t ProbeCount = sizeof(Probes) / sizeof(Probes[0]);
+
+    void healthy(FaultyRegisters &regs) {
+        regs.msr[PwrUnit] = 0xA1003;
+        regs.msr[PkgEnergy] = 0x12345678;
+        regs.msr[L3Cfg] = 0;
+        regs.msr[L3Ctr] = 0;
+        regs.smn[Tctl] = 0x5A00000;
+        regs.smn[SmuCommand] = 0x05;
+        regs.smn[SmuResponse] = 0x01;
+        regs.smn[SmuArgs] = 0;
+    }
+
+    Capability::Mask bits(std::initializer_list<uint8_t> capabilities) {
+        Capability::Mask mask = 0;
+        for (uint8_t c : capabilities)
+            mask |= Capability::bit(c);
+        return mask;
+    }
+}
+
+
+TEST_CASE(healthyMachineGrantsEachSpaceSeparately) {
+    FaultyRegisters regs;
+    healthy(regs);
+    RegisterBackend backend = regs.backend();
+
+    CHECK_EQ(CapabilityProbe::run(backend, Probes, ProbeCount, RegisterProbe::MSR),
+             bits({Capability::PowerUnit, Capability::PackageEnergy, Capability::L3Counters}));
+    CHECK_EQ(CapabilityProbe::run(backend, Probes, ProbeCount, RegisterProbe::SMN),
+             bits({Capability::Tctl, Capability::SMU}));
+}
+
+TEST_CASE(faultingMsrOnlyDropsItsCapability) {
+    FaultyRegisters regs;
+    healthy(regs);
+    regs.faults.insert(L3Cfg);
+
+    Capability::Mask granted = CapabilityProbe::run(regs.backend(), Probes, ProbeCount, RegisterProbe::MSR);
+    CHECK_EQ(granted, bits({Capability::PowerUnit, Capability::PackageEnergy}));
+
+    // The rest of a failed capability is not touched.
+    CHECK_EQ(regs.reads[L3Cfg], 1u);
+    CHECK_EQ(regs.reads[L3Ctr], 0u);
+}
+
+TEST_CASE(hypervisorWithoutMsrsKeepsSmnSensors) {
+    FaultyRegisters regs;
+    healthy(regs);
+    regs.msr.clear();
+    RegisterBackend backend = regs.backend();
+
+    CHECK_EQ(CapabilityProbe::run(backend, Probes, ProbeCount, RegisterProbe::MSR), 0u);
+    CHECK_EQ(CapabilityProbe::run(backend, Probes, ProbeCount, RegisterProbe::SMN),
+             bits({Capability::Tctl, Capability::SMU}));
+}
+
+TEST_CASE(smuMailboxNeedsAllThreeRegisters) {
+    const uint32_t mailbox[] = { SmuCommand, SmuResponse, SmuArgs };
+
+    for (uint32_t addr : mailbox) {
+        FaultyRegisters regs;
+        healthy(regs);
+        regs.faults.insert(addr);
+
+        Capability::Mask granted = CapabilityProbe::run(regs.backend(), Probes, ProbeCount, RegisterProbe::SMN);
+        CHECK_EQ(granted, bits({Capability::Tctl}));
+    }
+}
+
+TEST_CASE(emulatedRootComplexReadingZeroIsRejected) {
+    FaultyRegisters regs;
+    healthy(regs);
+    regs.smn[Tctl] = 0;
+    regs.smn[SmuResponse] = 0;
+
+    CHECK_EQ(CapabilityProbe::run(regs.backend(), Probes, ProbeCount, RegisterProbe::SMN), 0u);
+}
+
+TEST_CASE(missingBackendCallbackGrantsNothing) {
+    FaultyRegisters regs;
+    healthy(regs);
+    RegisterBackend backend = regs.backend();
+    backend.readSmn = nullptr;
+
+    CHECK_EQ(CapabilityProbe::run(backend, Probes, ProbeCount, RegisterProbe::SMN), 0u);
+    CHECK(CapabilityProbe::run(backend, Probes, ProbeCount, RegisterProbe::MSR) != 0);
+}
+
+TEST_CASE(outOfRangeCapabilityIsIgnored) {
+    FaultyRegisters regs;
+    healthy(regs);
+    const RegisterProbe probes[] = {
+        { Capability::Count, RegisterProbe::MSR, PwrUnit, nullptr },
+        { 31, RegisterProbe::MSR, PwrUnit, nullptr },
+    };
+
+    CHECK_EQ(CapabilityProbe::run(regs.backend(), probes, 2, RegisterProbe::MSR), 0u);
+    CHECK_EQ(regs.reads[PwrUnit], 0u);
+}
+
+TEST_CASE(everyCapabilityHasAName) {
+    for (uint8_t c = 0; c < Capability::Count; c++) {
+        CHECK(strcmp(Capability::name(c), "?") != 0);
+        for (uint8_t other = 0; other < c; other++)
+            CHECK(strcmp(Capability::name(c), Capability::name(other)) != 0);
+    }
+    CHECK(Capability::Count <= 8 * sizeof(Capability::Mask));
+}
+
+TEST_MAIN()
@@ -0,0 +1,120 @@
+//
+//  CoreTopologyTests.cpp
+//  SMCProcessorAMD
+//
+
+#include "CoreTopology.hpp"
+#include "TestHarness.hpp"
+
+#include <algorithm>
+#include <vector>
+
+
+namespace {
+    /**
+     *  Dual socket family 17h part, 2 CCD per package, 2 CCX per CCD, 3 of 4 cores enabled per CCX, SMT on.
+     *  APIC id = package [7], CCD [4], CCX [3], core [2:1], thread [0]. Cores are listed in
+     *  the interleaved order the kernel enumerates them in, not in APIC order.
+     */
+    std::vector<uint32_t> sparseApicIds() {
+        std::vector<uint32_t> ids;
+        for (uint32_t core = 0; core < 3; core++)
+            for (uint32_t ccx = 0; ccx < 8; ccx++)
+                ids.push_back(((ccx >> 2) << 7) | ((ccx & 3) << 3) | (core << 1));
+        return ids;
+    }
+
+    std::vector<uint32_t> shifted(const std::vector<uint32_t> &ids, uint8_t shift) {
+        std::vector<uint32_t> raw(ids.size());
+        for (size_t i = 0; i < ids.size(); i++)
+            raw[i] = ids[i] >> shift;
+        return raw;
+    }
+}
+
+
+TEST_CASE(populatedCcdsSkipsFusedOffRegisters) {
+    // CCD 1 and 4 fused off, 6 and 7 absent, one aborted read.
+    const uint32_t raw[8] = { 0x8a0, 0x000, 0x9c4, 0x812, 0x0, 0x850, 0xFFFFFFFF, 0x7ff };
+    uint8_t map[16] {};
+
+    CHECK_EQ(CoreTopology::populatedCcds(raw, 8, map, 16), 4u);
+    CHECK_EQ(map[0], 0);
+    CHECK_EQ(map[1], 2);
+    CHECK_EQ(map[2], 3);
+    CHECK_EQ(map[3], 5);
+}
+
+TEST_CASE(populatedCcdsStopsAtMaxCcds) {
+    const uint32_t raw[4] = { 0x800, 0x800, 0x800, 0x800 };
+    uint8_t map[2] {};
+
+    CHECK_EQ(CoreTopology::populatedCcds(raw, 4, map, 2), 2u);
+    CHECK_EQ(map[1], 1);
+}
+
+TEST_CASE(l3ShiftCoversAllSharingThreads) {
+    CHECK_EQ(CoreTopology::l3Shift(1), 0);
+    CHECK_EQ(CoreTopology::l3Shift(6), 3);
+    CHECK_EQ(CoreTopology::l3Shift(8), 3);
+    CHECK_EQ(CoreTopology::l3Shift(16), 4);
+}
+
+TEST_CASE(compactNumbersSparseCcxAcrossPackages) {
+    std::vector<uint32_t> ids = sparseApicIds();
+    uint8_t ccxShift = CoreTopology::l3Shift(8);
+
+    std::vector<uint32_t> raw = shifted(ids, ccxShift);
+    std::vector<uint8_t> ccx(ids.size());
+    CHECK_EQ(CoreTopology::compact(raw.data(), ccx.data(), ids.size(), 32), 8u);
+
+    // Dense ids follow APIC order: package 1 CCX come after every package 0 CCX.
+    for (size_t i = 0; i < ids.size(); i++)
+        CHECK_EQ(ccx[i], ((ids[i] >> 7) << 2) | ((ids[i] >> 3) & 3));
+
+    std::vector<uint32_t> ccdRaw = shifted(ids, ccxShift + 1);
+    std::vector<uint8_t> ccd(ids.size());
+    CHECK_EQ(CoreTopology::compact(ccdRaw.data(), ccd.data(), ids.size(), 16), 4u);
+    for (size_t i = 0; i < ids.size(); i++)
+        CHECK_EQ(ccd[i], ccx[i] >> 1);
+}
+
+TEST_CASE(compactFoldsGroupsPastTheLimit) {
+    const uint32_t raw[6] = { 40, 2, 17, 2, 40, 9 };
+    uint8_t dense[6] {};
+
+    CHECK_EQ(CoreTopology::compact(raw, dense, 6, 2), 2u);
+    CHECK_EQ(dense[1], 0);
+    CHECK_EQ(dense[3], 0);
+    CHECK_EQ(dense[5], 1);
+    CHECK_EQ(dense[2], 1);
+    CHECK_EQ(dense[0], 1);
+}
+
+TEST_CASE(leadersAreTheFirstEnumeratedCoreOfEachGroup) {
+    std::vector<uint32_t> ids = sparseApicIds();
+    std::vector<uint32_t> raw = shifted(ids, CoreTopology::l3Shift(8));
+    std::vector<uint8_t> ccx(ids.size());
+    size_t groups = CoreTopology::compact(raw.data(), ccx.data(), ids.size(), 32);
+
+    uint16_t leaders[32];
+    CHECK(CoreTopology::leaders(ccx.data(), ids.size(), leaders, groups));
+
+    for (size_t g = 0; g < groups; g++) {
+        size_t first = std::find(ccx.begin(), ccx.end(), (uint8_t)g) - ccx.begin();
+        CHECK_EQ(leaders[g], first);
+        // Core 0 of every CCX is enumerated first.
+        CHECK_EQ(ids[leaders[g]] & 0x6, 0u);
+    }
+}
+
+TEST_CASE(leadersFailsForAnEmptyGroup) {
+    const uint8_t dense[4] = { 0, 2, 2, 0 };
+    uint16_t leaders[3];
+
+    CHECK(!CoreTopology::leaders(dense, 4, leaders, 3));
+    CHECK_EQ(leaders[0], 0);
+    CHECK_EQ(leaders[2], 1);
+}
+
+TEST_MAIN()
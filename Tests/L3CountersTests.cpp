@@ -0,0 +1,63 @@
+//
+//  L3CountersTests.cpp
+//  SMCProcessorAMD
+//
+
+#include "L3Counters.hpp"
+#include "TestHarness.hpp"
+
+
+static constexpr uint64_t Ms = 1000000ULL;
+
+
+TEST_CASE(deltaWrapsAt48Bits) {
+    CHECK_EQ(L3Counters::delta(5, L3Counters::CounterMask - 4), 10u);
+    CHECK_EQ(L3Counters::delta(L3Counters::CounterMask, 0), L3Counters::CounterMask);
+    CHECK_EQ(L3Counters::delta(1234, 1234), 0u);
+
+    // Bits above the counter width are not part of the count.
+    CHECK_EQ(L3Counters::delta((0xABCDULL << 48) | 100, 40), 60u);
+}
+
+TEST_CASE(computeReportsHitRateAndMissBandwidth) {
+    L3Stats s = L3Counters::compute(5000, 1000, 1500, 500, 1 * Ms);
+
+    CHECK_EQ(s.accesses, 4000u);
+    CHECK_EQ(s.misses, 1000u);
+    CHECK_NEAR(s.hitRate, 0.75, 1e-6);
+    // 1000 lines of 64 bytes in 1 ms.
+    CHECK_NEAR(s.missBandwidthMBps, 64.0, 1e-3);
+}
+
+TEST_CASE(computeAcrossAWrap) {
+    L3Stats s = L3Counters::compute(999, L3Counters::CounterMask - 1000, 10, L3Counters::CounterMask - 89, 10 * Ms);
+
+    CHECK_EQ(s.accesses, 2000u);
+    CHECK_EQ(s.misses, 100u);
+    CHECK_NEAR(s.hitRate, 0.95, 1e-6);
+}
+
+TEST_CASE(missesAreClampedToAccesses) {
+    L3Stats s = L3Counters::compute(100, 0, 250, 0, 1 * Ms);
+
+    CHECK_EQ(s.misses, s.accesses);
+    CHECK_NEAR(s.hitRate, 0.0, 1e-6);
+    CHECK_NEAR(s.missBandwidthMBps, 6.4, 1e-4);
+}
+
+TEST_CASE(idleIntervalReportsZeros) {
+    L3Stats s = L3Counters::compute(7, 7, 3, 3, 0);
+
+    CHECK_EQ(s.accesses, 0u);
+    CHECK_NEAR(s.hitRate, 0.0, 1e-6);
+    CHECK_NEAR(s.missBandwidthMBps, 0.0, 1e-6);
+}
+
+TEST_CASE(configOnlyForKnownFamilies) {
+    CHECK_EQ(L3Counters::config(0x15, L3Counters::Accesses), 0u);
+    CHECK(L3Counters::config(0x17, L3Counters::Accesses) & (1ULL << 22));
+    CHECK(L3Counters::config(0x19, L3Counters::Misses) & (1ULL << 22));
+    CHECK(L3Counters::config(0x17, L3Counters::Accesses) != L3Counters::config(0x17, L3Counters::Misses));
+}
+
+TEST_MAIN()
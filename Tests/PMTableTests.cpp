@@ -0,0 +1,262 @@
+//
+//  PMTableTests.cpp
+//  SMCProcessorAMD
+//
+
+#include "PMTable.hpp"
+#include "SMUMailbox.hpp"
+#include "TestHarness.hpp"
+
+#include <cstring>
+#include <map>
+#include <vector>
+
+
+namespace {
+    /**
+     *  A 0x380805 (Vermeer) sized table: the limit/value block at the built-in offsets,
+     *  voltage and per-core arrays at the offsets vermeerOverride() maps.
+     */
+    std::vector<uint8_t> vermeerTable() {
+        std::vector<uint8_t> table(0x8F0, 0xA5);
+        auto put = [&table](uint32_t offset, float v) { memcpy(&table[offset], &v, sizeof(v)); };
+
+        put(0x000, 142.0f);     // PPT limit
+        put(0x004, 87.25f);     // PPT value
+        put(0x008, 95.0f);      // TDC limit
+        put(0x00C, 61.5f);      // TDC value
+        put(0x010, 90.0f);      // THM limit
+        put(0x014, 72.125f);    // THM value
+        put(0x020, 140.0f);     // EDC limit
+        put(0x024, 110.75f);    // EDC value
+        put(0x0A0, 1.28125f);   // SVI2 core voltage
+
+        for (uint32_t core = 0; core < 8; core++) {
+            put(0x600 + core * 4, 5.5f + core);
+            put(0x640 + core * 4, 60.0f + core);
+            put(0x680 + core * 4, 4.2f + core * 0.05f);
+        }
+        return table;
+    }
+
+    PMTableLayout vermeerOverride() {
+        PMTable parser;
+        PMTableLayout layout = *parser.layoutFor(0x380805);
+        layout.coreVoltage = 0x0A0;
+        layout.coreSlots = 8;
+        layout.corePower = 0x600;
+        layout.coreTemperature = 0x640;
+        layout.coreEffectiveClock = 0x680;
+        return layout;
+    }
+
+    /**
+     *  Simulated SMU answering the PM table messages of a profile. TransferTableToDram copies
+     *  `table` into the DRAM buffer at `base`, which GetDramBaseAddress only reports after
+     *  the first transfer.
+     */
+    struct PMTableSmu {
+        const SMUProfile &profile;
+        uint32_t version;
+        uint64_t base;
+        std::vector<uint8_t> table;
+        std::vector<uint8_t> dram;
+        std::map<uint32_t, uint32_t> regs;
+        std::vector<uint32_t> commands;
+        uint32_t transferReply {0x01};
+
+        PMTableSmu(const SMUProfile &profile, uint32_t version, uint64_t base, std::vector<uint8_t> table) :
+            profile(profile), version(version), base(base), table(table) {
+            regs[profile.rsmu.response] = 0x01;
+        }
+
+        SMNBackend backend() {
+            SMNBackend b {};
+            b.context = this;
+            b.read = [](void *context, uint32_t addr, uint32_t *value) {
+                *value = static_cast<PMTableSmu*>(context)->regs[addr];
+                return true;
+            };
+            b.write = [](void *context, uint32_t addr, uint32_t value) {
+                auto smu = static_cast<PMTableSmu*>(context);
+                smu->regs[addr] = value;
+                if (addr == smu->profile.rsmu.command)
+                    smu->execute(value);
+                return true;
+            };
+            return b;
+        }
+
+        uint32_t &arg(uint32_t i) { return regs[profile.rsmu.args + i * 4]; }
+
+        void execute(uint32_t command) {
+            commands.push_back(command);
+            uint32_t reply = 0x01;
+            if (command == profile.getPmTableVersion) {
+                arg(0) = version;
+            } else if (command == profile.transferTableToDram) {
+                reply = transferReply;
+                if (reply == 0x01)
+                    dram = table;
+            } else if (command == profile.getDramBaseAddress) {
+                arg(0) = dram.empty() ? 0 : (uint32_t)base;
+                arg(1) = dram.empty() ? 0 : (uint32_t)(base >> 32);
+            } else {
+                reply = 0xFE;
+            }
+            regs[profile.rsmu.response] = reply;
+        }
+
+        /**
+         *  What the driver's mapping of `address` reads, up to size bytes.
+         */
+        size_t copy(uint64_t address, uint8_t *out, size_t size) const {
+            if (address != base)
+                return 0;
+            size_t n = size < dram.size() ? size : dram.size();
+            memcpy(out, dram.data(), n);
+            return n;
+        }
+    };
+}
+
+
+TEST_CASE(builtinLayoutsMatchTheFirmwareTableSizes) {
+    PMTable parser;
+    CHECK_EQ(parser.layoutFor(0x240903)->size, 0x518u);
+    CHECK_EQ(parser.layoutFor(0x380804)->size, 0x8A4u);
+    CHECK_EQ(parser.layoutFor(0x380805)->size, 0x8F0u);
+    CHECK(parser.layoutFor(0x240803) == nullptr);
+}
+
+TEST_CASE(parsesTheLimitBlockOfARecordedTable) {
+    PMTable parser;
+    std::vector<uint8_t> table = vermeerTable();
+    PMTelemetry out {};
+
+    CHECK(parser.parse(0x380805, table.data(), table.size(), out));
+    CHECK(out.valid);
+    CHECK_EQ(out.version, 0x380805u);
+    CHECK_NEAR(out.pptLimit, 142.0, 1e-6);
+    CHECK_NEAR(out.pptValue, 87.25, 1e-6);
+    CHECK_NEAR(out.tdcValue, 61.5, 1e-6);
+    CHECK_NEAR(out.thmValue, 72.125, 1e-6);
+    CHECK_NEAR(out.edcValue, 110.75, 1e-6);
+
+    // Not in the built-in layout.
+    CHECK(out.coreVoltage != out.coreVoltage);
+    CHECK_EQ(out.coreSlots, 0u);
+    CHECK(out.corePower[0] != out.corePower[0]);
+}
+
+TEST_CASE(overrideMapsVoltageAndPerCoreArrays) {
+    PMTable parser;
+    CHECK(parser.addLayout(vermeerOverride()));
+
+    std::vector<uint8_t> table = vermeerTable();
+    PMTelemetry out {};
+    CHECK(parser.parse(0x380805, table.data(), table.size(), out));
+
+    CHECK_NEAR(out.coreVoltage, 1.28125, 1e-6);
+    CHECK_EQ(out.coreSlots, 8u);
+    CHECK_NEAR(out.corePower[7], 12.5, 1e-6);
+    CHECK_NEAR(out.coreTemperature[3], 63.0, 1e-6);
+    // Stored in GHz, reported in MHz.
+    CHECK_NEAR(out.coreEffectiveClock[2], 4300.0, 1e-3);
+    CHECK(out.corePower[8] != out.corePower[8]);
+}
+
+TEST_CASE(shortOrUnknownTablesAreRejected) {
+    PMTable parser;
+    std::vector<uint8_t> table = vermeerTable();
+    PMTelemetry out {};
+    out.valid = true;
+
+    CHECK(!parser.parse(0x380805, table.data(), 0x8A4, out));
+    CHECK(!out.valid);
+    CHECK(!parser.parse(0x123456, table.data(), table.size(), out));
+    CHECK(!parser.parse(0x380805, nullptr, table.size(), out));
+}
+
+TEST_CASE(layoutsOutsideTheTableAreRejected) {
+    PMTable parser;
+
+    PMTableLayout layout = vermeerOverride();
+    layout.coreVoltage = 0x8F0;
+    CHECK(!parser.addLayout(layout));
+
+    layout = vermeerOverride();
+    layout.corePower = 0x8F0 - 4 * 7;
+    CHECK(!parser.addLayout(layout));
+
+    layout = vermeerOverride();
+    layout.size = PMTable::MaxSize + 4;
+    CHECK(!parser.addLayout(layout));
+
+    layout = vermeerOverride();
+    layout.coreSlots = PMTelemetry::MaxCores + 1;
+    CHECK(!parser.addLayout(layout));
+
+    // Nothing above replaced the built-in layout.
+    CHECK_EQ(parser.layoutFor(0x380805)->coreSlots, 0u);
+}
+
+TEST_CASE(smuVersionTransferCopyParse) {
+    const SMUProfile *vermeer = SMUProfile::find(0x19, 0x21);
+    CHECK(vermeer != nullptr);
+
+    PMTableSmu smu(*vermeer, 0x380805, 0x12FFE0000ULL, vermeerTable());
+    SMUMailbox mailbox(smu.backend(), vermeer->rsmu);
+    PMTable parser;
+    CHECK(parser.addLayout(vermeerOverride()));
+
+    uint32_t version = 0;
+    uint64_t address = 0;
+    CHECK_EQ(mailbox.locatePmTable(*vermeer, &version, &address), SMUMailbox::OK);
+    CHECK_EQ(version, 0x380805u);
+    CHECK_EQ(address, 0x12FFE0000ULL);
+    const uint32_t order[] = { vermeer->getPmTableVersion, vermeer->transferTableToDram, vermeer->getDramBaseAddress };
+    CHECK_EQ(smu.commands.size(), 3u);
+    for (size_t i = 0; i < 3 && i < smu.commands.size(); i++)
+        CHECK_EQ(smu.commands[i], order[i]);
+
+    const PMTableLayout *layout = parser.layoutFor(version);
+    CHECK(layout != nullptr);
+    uint8_t buffer[PMTable::MaxSize];
+    size_t copied = smu.copy(address, buffer, layout->size);
+    CHECK_EQ(copied, (size_t)layout->size);
+
+    PMTelemetry out {};
+    CHECK(parser.parse(version, buffer, copied, out));
+    CHECK_NEAR(out.pptValue, 87.25, 1e-6);
+    CHECK_NEAR(out.coreVoltage, 1.28125, 1e-6);
+    CHECK_NEAR(out.coreEffectiveClock[7], 4550.0, 1e-3);
+
+    // The next tick only transfers, the mapping then reads the new values.
+    float ppt = 120.5f;
+    memcpy(&smu.table[0x004], &ppt, sizeof(ppt));
+    CHECK_EQ(mailbox.transferPmTable(*vermeer), SMUMailbox::OK);
+    CHECK_EQ(smu.commands.back(), vermeer->transferTableToDram);
+    copied = smu.copy(address, buffer, layout->size);
+    CHECK(parser.parse(version, buffer, copied, out));
+    CHECK_NEAR(out.pptValue, 120.5, 1e-6);
+}
+
+TEST_CASE(failedFirstTransferReportsNoAddress) {
+    const SMUProfile *matisse = SMUProfile::find(0x17, 0x71);
+    CHECK(matisse != nullptr);
+
+    PMTableSmu smu(*matisse, 0x240903, 0xBEEF0000ULL, std::vector<uint8_t>(0x518));
+    smu.transferReply = 0xFC;
+    SMUMailbox mailbox(smu.backend(), matisse->rsmu);
+
+    uint32_t version = 0;
+    uint64_t address = 1;
+    CHECK_EQ(mailbox.locatePmTable(*matisse, &version, &address), SMUMailbox::RejectedBusy);
+    CHECK_EQ(version, 0x240903u);
+    CHECK_EQ(address, 0u);
+    // GetDramBaseAddress is not asked before a table exists.
+    CHECK_EQ(smu.commands.size(), 2u);
+}
+
+TEST_MAIN()
@@ -0,0 +1,169 @@
+//
+//  SMUMailboxTests.cpp
+//  SMCProcessorAMD
+//
+
+#include "SMUMailbox.hpp"
+#include "TestHarness.hpp"
+
+#include <map>
+
+
+namespace {
+    const SMUMailboxLayout Layout { 0x03B10524, 0x03B10570, 0x03B10A40 };
+
+    /**
+     *  Simulated SMU. Writing the command register schedules `reply` in the response
+     *  register after `latency` polls and doubles every argument, unless it is wedged.
+     */
+    struct FakeSmu {
+        std::map<uint32_t, uint32_t> regs;
+        uint32_t reply {0x01};
+        uint32_t latency {0};
+        bool wedged {false};
+        bool failReads {false};
+
+        uint32_t pending {0};
+        uint32_t commands {0};
+        uint32_t lastCommand {0};
+        uint64_t delayedUs {0};
+
+        FakeSmu() {
+            // Idle mailbox: the previous message has completed.
+            regs[Layout.response] = 0x01;
+        }
+
+        SMNBackend backend() {
+            SMNBackend b {};
+            b.context = this;
+            b.read = [](void *context, uint32_t addr, uint32_t *value) {
+                auto smu = static_cast<FakeSmu*>(context);
+                if (smu->failReads)
+                    return false;
+                if (addr == Layout.response && smu->pending && --smu->pending == 0)
+                    smu->complete();
+                *value = smu->regs[addr];
+                return true;
+            };
+            b.write = [](void *context, uint32_t addr, uint32_t value) {
+                auto smu = static_cast<FakeSmu*>(context);
+                smu->regs[addr] = value;
+                if (addr == Layout.command) {
+                    smu->commands++;
+                    smu->lastCommand = value;
+                    if (!smu->wedged) {
+                        smu->pending = smu->latency + 1;
+                        if (smu->latency == 0) {
+                            smu->pending = 0;
+                            smu->complete();
+                        }
+                    }
+                }
+                return true;
+            };
+            b.delay = [](void *context, uint32_t us) {
+                static_cast<FakeSmu*>(context)->delayedUs += us;
+            };
+            return b;
+        }
+
+        void complete() {
+            for (uint32_t i = 0; i < SMUMailbox::ArgCount; i++)
+                regs[Layout.args + i * 4] *= 2;
+            regs[Layout.response] = reply;
+        }
+    };
+}
+
+
+TEST_CASE(okReturnsTheReplyArguments) {
+    FakeSmu smu;
+    smu.latency = 3;
+    SMUMailbox mailbox(smu.backend(), Layout);
+
+    uint32_t args[SMUMailbox::ArgCount] = {1, 2, 3, 4, 5, 6};
+    CHECK_EQ(mailbox.send(0x05, args), SMUMailbox::OK);
+    CHECK_EQ(smu.lastCommand, 0x05u);
+    CHECK_EQ(args[0], 2u);
+    CHECK_EQ(args[5], 12u);
+    CHECK_EQ(smu.delayedUs, 3u * SMUMailbox::PollDelayUs);
+}
+
+TEST_CASE(rejectionsAreReported) {
+    const struct { uint32_t reply; SMUMailbox::Status status; } cases[] = {
+        { 0xFC, SMUMailbox::RejectedBusy },
+        { 0xFD, SMUMailbox::RejectedPrerequisite },
+        { 0xFE, SMUMailbox::UnknownCommand },
+        { 0xFF, SMUMailbox::Failed },
+    };
+
+    for (const auto &c : cases) {
+        FakeSmu smu;
+        smu.reply = c.reply;
+        SMUMailbox mailbox(smu.backend(), Layout);
+
+        uint32_t args[SMUMailbox::ArgCount] = {7};
+        CHECK_EQ(mailbox.send(0x05, args), c.status);
+        // A rejected message leaves the caller's arguments alone.
+        CHECK_EQ(args[0], 7u);
+    }
+}
+
+TEST_CASE(silentSmuTimesOutWithinThePollBudget) {
+    FakeSmu smu;
+    smu.wedged = true;
+    SMUMailbox mailbox(smu.backend(), Layout, SMUMailbox::TickPolls);
+
+    uint32_t args[SMUMailbox::ArgCount] {};
+    CHECK_EQ(mailbox.send(0x05, args), SMUMailbox::Timeout);
+    CHECK_EQ(smu.commands, 1u);
+    CHECK_EQ(smu.delayedUs, (uint64_t)SMUMailbox::TickPolls * SMUMailbox::PollDelayUs);
+
+    // Still busy with the lost message: the next send gives up before writing anything.
+    smu.delayedUs = 0;
+    CHECK_EQ(mailbox.send(0x05, args), SMUMailbox::Timeout);
+    CHECK_EQ(smu.commands, 1u);
+    CHECK_EQ(smu.delayedUs, (uint64_t)SMUMailbox::TickPolls * SMUMailbox::PollDelayUs);
+}
+
+TEST_CASE(slowReplyWithinBudgetSucceeds) {
+    FakeSmu smu;
+    smu.latency = SMUMailbox::TickPolls - 1;
+    SMUMailbox mailbox(smu.backend(), Layout, SMUMailbox::TickPolls);
+
+    uint32_t args[SMUMailbox::ArgCount] {};
+    CHECK_EQ(mailbox.send(0x05, args), SMUMailbox::OK);
+
+    smu.latency = SMUMailbox::TickPolls;
+    CHECK_EQ(mailbox.send(0x05, args), SMUMailbox::Timeout);
+}
+
+TEST_CASE(setMaxPollsShrinksTheBudget) {
+    FakeSmu smu;
+    smu.wedged = true;
+    SMUMailbox mailbox(smu.backend(), Layout);
+    mailbox.setMaxPolls(4);
+
+    uint32_t args[SMUMailbox::ArgCount] {};
+    CHECK_EQ(mailbox.send(0x05, args), SMUMailbox::Timeout);
+    CHECK_EQ(smu.delayedUs, 4u * SMUMailbox::PollDelayUs);
+}
+
+TEST_CASE(backendFaultIsReported) {
+    FakeSmu smu;
+    smu.failReads = true;
+    SMUMailbox mailbox(smu.backend(), Layout);
+
+    uint32_t args[SMUMailbox::ArgCount] {};
+    CHECK_EQ(mailbox.send(0x05, args), SMUMailbox::BackendError);
+    CHECK_EQ(smu.commands, 0u);
+}
+
+TEST_CASE(profilesCoverOnlyPartsWithALayout) {
+    CHECK(SMUProfile::find(0x17, 0x71) != nullptr);
+    CHECK(SMUProfile::find(0x19, 0x21) != nullptr);
+    CHECK(SMUProfile::find(0x17, 0x31) == nullptr);
+    CHECK(SMUProfile::find(0x19, 0x50) == nullptr);
+}
+
+TEST_MAIN()
@@ -0,0 +1,106 @@
+//
+//  SamplingSchedulerTests.cpp
+//  SMCProcessorAMD
+//
+
+#include "SamplingScheduler.hpp"
+#include "TestHarness.hpp"
+
+
+static constexpr uint64_t Ms = 1000000ULL;
+
+namespace {
+    /**
+     *  Drives the scheduler like the timer does: sleep to the next deadline, wake, collect.
+     */
+    struct VirtualClock {
+        uint64_t runs[SamplingScheduler::MaxGroups] {};
+
+        void run(SamplingScheduler &scheduler, uint64_t startNs, uint64_t endNs) {
+            uint64_t now = startNs;
+            scheduler.start(now);
+            for (;;) {
+                uint64_t next = scheduler.nextDeadline();
+                if (next == SamplingScheduler::Never || next > endNs)
+                    break;
+                now = next;
+                uint32_t due = scheduler.collectDue(now);
+                for (size_t i = 0; i < SamplingScheduler::MaxGroups; i++)
+                    if (due & (1u << i))
+                        runs[i]++;
+            }
+        }
+    };
+}
+
+
+TEST_CASE(sharedTimerWakesOncePerDistinctDeadline) {
+    SamplingScheduler scheduler;
+    scheduler.setPeriod(0, 100);
+    scheduler.setPeriod(1, 250);
+    scheduler.setPeriod(2, 3000);
+
+    VirtualClock clock;
+    clock.run(scheduler, 0, 10000 * Ms);
+
+    CHECK_EQ(clock.runs[0], 100u);
+    CHECK_EQ(clock.runs[1], 40u);
+    CHECK_EQ(clock.runs[2], 3u);
+
+    // 100 ms ticks, plus the 20 250 ms deadlines that fall between them.
+    CHECK_EQ(scheduler.wakeups(), 120u);
+}
+
+TEST_CASE(deadlinesWithinCoalesceWindowShareAWakeup) {
+    SamplingScheduler scheduler;
+    scheduler.setPeriod(0, 100);
+    scheduler.setPeriod(1, 104);
+    scheduler.start(0);
+
+    CHECK_EQ(scheduler.nextDeadline(), 100 * Ms);
+    CHECK_EQ(scheduler.collectDue(100 * Ms), 0x3u);
+    CHECK_EQ(scheduler.nextDeadline(), 200 * Ms);
+}
+
+TEST_CASE(lateWakeupRunsOnceAndRestartsFromNow) {
+    SamplingScheduler scheduler;
+    scheduler.setPeriod(0, 100);
+    scheduler.start(0);
+
+    // Slept through ten periods.
+    CHECK_EQ(scheduler.collectDue(1050 * Ms), 0x1u);
+    CHECK_EQ(scheduler.nextDeadline(), 1150 * Ms);
+    CHECK_EQ(scheduler.collectDue(1060 * Ms), 0u);
+}
+
+TEST_CASE(periodsAreClamped) {
+    SamplingScheduler scheduler;
+
+    scheduler.setPeriod(0, 1);
+    CHECK_EQ(scheduler.period(0), SamplingScheduler::MinPeriodMs);
+
+    scheduler.setPeriod(1, UINT32_MAX);
+    CHECK_EQ(scheduler.period(1), SamplingScheduler::MaxPeriodMs);
+
+    // The longest period must still fit the 32 bit microsecond timer delay.
+    CHECK((uint64_t)SamplingScheduler::MaxPeriodMs * 1000 + SamplingScheduler::CoalesceNs / 1000 <= UINT32_MAX);
+
+    scheduler.setPeriod(SamplingScheduler::MaxGroups, 100);
+    CHECK_EQ(scheduler.period(SamplingScheduler::MaxGroups), 0u);
+}
+
+TEST_CASE(disabledGroupsNeverRun) {
+    SamplingScheduler scheduler;
+    scheduler.start(0);
+    CHECK_EQ(scheduler.nextDeadline(), SamplingScheduler::Never);
+
+    scheduler.setPeriod(0, 100);
+    scheduler.setPeriod(1, 100);
+    scheduler.start(0);
+    scheduler.setPeriod(1, 0);
+
+    CHECK_EQ(scheduler.collectDue(100 * Ms), 0x1u);
+    CHECK_EQ(scheduler.collectDue(200 * Ms), 0x1u);
+}
+
+TEST_MAIN()
@@ -0,0 +1,221 @@
+//
+//  SensorEventsTests.cpp
+//  SMCProcessorAMD
+//
+
+#include "SensorEvents.hpp"
+#include "TestHarness.hpp"
+
+#include <vector>
+
+
+static constexpr uint64_t Ms = 1000000ULL;
+
+namespace {
+    struct Recorder {
+        std::vector<ThresholdEvent> events;
+
+        static void sink(void *, const ThresholdEvent &event, void *context) {
+            static_cast<Recorder*>(context)->events.push_back(event);
+        }
+    };
+
+    struct Values {
+        float v[SensorId::Count];
+
+        Values() {
+            for (size_t i = 0; i < SensorId::Count; i++)
+                v[i] = NAN;
+        }
+    };
+
+    ThresholdSpec spec(uint16_t sensor, uint8_t direction, float threshold, float hysteresis, uint32_t minDurationMs) {
+        ThresholdSpec s {};
+        s.sensor = sensor;
+        s.direction = direction;
+        s.threshold = threshold;
+        s.hysteresis = hysteresis;
+        s.minDurationMs = minDurationMs;
+        return s;
+    }
+}
+
+static int ownerA, ownerB;
+
+
+TEST_CASE(raisesOnlyAfterMinDuration) {
+    ThresholdEvaluator evaluator;
+    Recorder rec;
+    Values values;
+
+    uint32_t id = evaluator.subscribe(spec(SensorId::PackageTemperature, ThresholdSpec::Above, 80, 5, 500), &ownerA);
+    CHECK(id != 0);
+
+    values.v[SensorId::PackageTemperature] = 85;
+    evaluator.evaluate(values.v, 1000 * Ms, Recorder::sink, &rec);
+    evaluator.evaluate(values.v, 1400 * Ms, Recorder::sink, &rec);
+    CHECK_EQ(rec.events.size(), 0u);
+
+    evaluator.evaluate(values.v, 1500 * Ms, Recorder::sink, &rec);
+    CHECK_EQ(rec.events.size(), 1u);
+    CHECK_EQ(rec.events[0].kind, ThresholdEvent::Raised);
+    CHECK_EQ(rec.events[0].subscription, id);
+    CHECK_EQ(rec.events[0].timestampNs, 1500 * Ms);
+
+    // Stays raised, no repeat.
+    evaluator.evaluate(values.v, 2000 * Ms, Recorder::sink, &rec);
+    CHECK_EQ(rec.events.size(), 1u);
+}
+
+TEST_CASE(dipBeforeMinDurationRestartsTheWait) {
+    ThresholdEvaluator evaluator;
+    Recorder rec;
+    Values values;
+
+    evaluator.subscribe(spec(SensorId::PackageTemperature, ThresholdSpec::Above, 80, 0, 500), &ownerA);
+
+    values.v[SensorId::PackageTemperature] = 85;
+    evaluator.evaluate(values.v, 0, Recorder::sink, &rec);
+    values.v[SensorId::PackageTemperature] = 79;
+    evaluator.evaluate(values.v, 300 * Ms, Recorder::sink, &rec);
+    values.v[SensorId::PackageTemperature] = 85;
+    evaluator.evaluate(values.v, 600 * Ms, Recorder::sink, &rec);
+    CHECK_EQ(rec.events.size(), 0u);
+
+    evaluator.evaluate(values.v, 1100 * Ms, Recorder::sink, &rec);
+    CHECK_EQ(rec.events.size(), 1u);
+}
+
+TEST_CASE(clearsAtThresholdMinusHysteresis) {
+    ThresholdEvaluator evaluator;
+    Recorder rec;
+    Values values;
+
+    evaluator.subscribe(spec(SensorId::PackageTemperature, ThresholdSpec::Above, 80, 5, 0), &ownerA);
+
+    values.v[SensorId::PackageTemperature] = 81;
+    evaluator.evaluate(values.v, 0, Recorder::sink, &rec);
+    CHECK_EQ(rec.events.size(), 1u);
+
+    // Inside the hysteresis band, still active.
+    values.v[SensorId::PackageTemperature] = 76;
+    evaluator.evaluate(values.v, 1 * Ms, Recorder::sink, &rec);
+    CHECK_EQ(rec.events.size(), 1u);
+
+    values.v[SensorId::PackageTemperature] = 75;
+    evaluator.evaluate(values.v, 2 * Ms, Recorder::sink, &rec);
+    CHECK_EQ(rec.events.size(), 2u);
+    CHECK_EQ(rec.events[1].kind, ThresholdEvent::Cleared);
+    CHECK_NEAR(rec.events[1].value, 75, 1e-6);
+}
+
+TEST_CASE(belowRulesAreMirrored) {
+    ThresholdEvaluator evaluator;
+    Recorder rec;
+    Values values;
+
+    uint16_t sensor = SensorId::CoreClockBase + 3;
+    evaluator.subscribe(spec(sensor, ThresholdSpec::Below, 1000, 200, 0), &ownerA);
+
+    values.v[sensor] = 1500;
+    evaluator.evaluate(values.v, 0, Recorder::sink, &rec);
+    CHECK_EQ(rec.events.size(), 0u);
+
+    values.v[sensor] = 900;
+    evaluator.evaluate(values.v, 1 * Ms, Recorder::sink, &rec);
+    CHECK_EQ(rec.events.size(), 1u);
+    CHECK_EQ(rec.events[0].kind, ThresholdEvent::Raised);
+    CHECK_EQ(rec.events[0].direction, ThresholdSpec::Below);
+    CHECK_EQ(rec.events[0].sensor, sensor);
+
+    values.v[sensor] = 1100;
+    evaluator.evaluate(values.v, 2 * Ms, Recorder::sink, &rec);
+    CHECK_EQ(rec.events.size(), 1u);
+
+    values.v[sensor] = 1200;
+    evaluator.evaluate(values.v, 3 * Ms, Recorder::sink, &rec);
+    CHECK_EQ(rec.events.size(), 2u);
+    CHECK_EQ(rec.events[1].kind, ThresholdEvent::Cleared);
+}
+
+TEST_CASE(nanSamplesAreSkipped) {
+    ThresholdEvaluator evaluator;
+    Recorder rec;
+    Values values;
+
+    evaluator.subscribe(spec(SensorId::PackagePower, ThresholdSpec::Above, 100, 0, 500), &ownerA);
+
+    values.v[SensorId::PackagePower] = 120;
+    evaluator.evaluate(values.v, 0, Recorder::sink, &rec);
+
+    // A missing sample neither resets the pending rule nor raises it.
+    values.v[SensorId::PackagePower] = NAN;
+    evaluator.evaluate(values.v, 600 * Ms, Recorder::sink, &rec);
+    CHECK_EQ(rec.events.size(), 0u);
+
+    values.v[SensorId::PackagePower] = 120;
+    evaluator.evaluate(values.v, 700 * Ms, Recorder::sink, &rec);
+    CHECK_EQ(rec.events.size(), 1u);
+}
+
+TEST_CASE(invalidRulesAreRejected) {
+    ThresholdEvaluator evaluator;
+
+    CHECK_EQ(evaluator.subscribe(spec(SensorId::Count, ThresholdSpec::Above, 1, 0, 0), &ownerA), 0u);
+    CHECK_EQ(evaluator.subscribe(spec(0, 2, 1, 0, 0), &ownerA), 0u);
+    CHECK_EQ(evaluator.subscribe(spec(0, ThresholdSpec::Above, NAN, 0, 0), &ownerA), 0u);
+    CHECK_EQ(evaluator.subscribe(spec(0, ThresholdSpec::Above, 1, -1, 0), &ownerA), 0u);
+    CHECK_EQ(evaluator.subscriptionCount(), 0u);
+}
+
+TEST_CASE(fullTableRejectsNewRules) {
+    ThresholdEvaluator evaluator;
+
+    for (size_t i = 0; i < ThresholdEvaluator::MaxSubscriptions; i++)
+        CHECK(evaluator.subscribe(spec((uint16_t)(i % SensorId::Count), ThresholdSpec::Above, 1, 0, 0), &ownerA) != 0);
+
+    CHECK_EQ(evaluator.subscriptionCount(), ThresholdEvaluator::MaxSubscriptions);
+    CHECK_EQ(evaluator.subscribe(spec(0, ThresholdSpec::Above, 1, 0, 0), &ownerA), 0u);
+}
+
+TEST_CASE(staleIdIsRejectedAfterSlotReuse) {
+    ThresholdEvaluator evaluator;
+
+    uint32_t first = evaluator.subscribe(spec(0, ThresholdSpec::Above, 1, 0, 0), &ownerA);
+    CHECK(evaluator.unsubscribe(first, &ownerA));
+    CHECK(!evaluator.unsubscribe(first, &ownerA));
+
+    // Same slot, new id.
+    uint32_t second = evaluator.subscribe(spec(0, ThresholdSpec::Above, 1, 0, 0), &ownerA);
+    CHECK_EQ(second & 0xff, first & 0xff);
+    CHECK(second != first);
+
+    CHECK(!evaluator.unsubscribe(first, &ownerA));
+    CHECK(!evaluator.unsubscribe(second, &ownerB));
+    CHECK_EQ(evaluator.subscriptionCount(), 1u);
+    CHECK(evaluator.unsubscribe(second, &ownerA));
+}
+
+TEST_CASE(unsubscribeAllOnlyDropsThatOwner) {
+    ThresholdEvaluator evaluator;
+    Recorder rec;
+    Values values;
+
+    evaluator.subscribe(spec(0, ThresholdSpec::Above, 10, 0, 0), &ownerA);
+    evaluator.subscribe(spec(1, ThresholdSpec::Above, 10, 0, 0), &ownerA);
+    uint32_t kept = evaluator.subscribe(spec(0, ThresholdSpec::Above, 10, 0, 0), &ownerB);
+
+    evaluator.unsubscribeAll(&ownerA);
+    CHECK_EQ(evaluator.subscriptionCount(), 1u);
+
+    values.v[0] = 20;
+    values.v[1] = 20;
+    evaluator.evaluate(values.v, 0, Recorder::sink, &rec);
+    CHECK_EQ(rec.events.size(), 1u);
+    CHECK_EQ(rec.events[0].subscription, kept);
+
+    // Freed slots are usable again.
+    CHECK(evaluator.subscribe(spec(1, ThresholdSpec::Above, 10, 0, 0), &ownerA) != 0);
+}
+
+TEST_MAIN()
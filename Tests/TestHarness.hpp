@@ -0,0 +1,89 @@
+//
+//  TestHarness.hpp
+//  SMCProcessorAMD
+//
+//  Minimal self-registering test runner for the host tests, no dependencies.
+//
+
+#ifndef TestHarness_hpp
+#define TestHarness_hpp
+
+#include <cmath>
+#include <cstdio>
+
+
+namespace TestHarness {
+    struct Case {
+        const char *name;
+        void (*run)();
+        Case *next;
+    };
+
+    inline Case *&head() {
+        static Case *cases = nullptr;
+        return cases;
+    }
+
+    inline int &failures() {
+        static int count = 0;
+        return count;
+    }
+
+    struct Registrar {
+        Case entry;
+        Registrar(const char *name, void (*run)()) : entry {name, run, nullptr} {
+            // Append so cases run in source order.
+            Case **tail = &head();
+            while (*tail)
+                tail = &(*tail)->next;
+            *tail = &entry;
+        }
+    };
+
+    inline int runAll() {
+        int cases = 0;
+        for (Case *c = head(); c; c = c->next) {
+            int before = failures();
+            c->run();
+            printf("%s %s\n", failures() == before ? "PASS" : "FAIL", c->name);
+            cases++;
+        }
+        printf("%d cases, %d failed checks\n", cases, failures());
+        return failures() ? 1 : 0;
+    }
+}
+
+#define TEST_CASE(name) \
+    static void name(); \
+    static TestHarness::Registrar name##Registrar(#name, name); \
+    static void name()
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("  %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        TestHarness::failures()++; \
+    } \
+} while (0)
+
+#define CHECK_EQ(a, b) do { \
+    auto checkA = (a); \
+    auto checkB = (b); \
+    if (!(checkA == checkB)) { \
+        printf("  %s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, \
+               (long long)checkA, (long long)checkB); \
+        TestHarness::failures()++; \
+    } \
+} while (0)
+
+#define CHECK_NEAR(a, b, eps) do { \
+    double checkA = (a); \
+    double checkB = (b); \
+    if (!(std::fabs(checkA - checkB) <= (eps))) { \
+        printf("  %s:%d: CHECK_NEAR(%s, %s) failed: %g != %g\n", __FILE__, __LINE__, #a, #b, checkA, checkB); \
+        TestHarness::failures()++; \
+    } \
+} while (0)
+
+#define TEST_MAIN() int main() { return TestHarness::runAll(); }
+
+#endif /* TestHarness_hpp */
@@ -0,0 +1,191 @@
+//
+//  TraceFormatTests.cpp
+//  SMCProcessorAMD
+//
+
+#include "TraceFormat.hpp"
+#include "TestHarness.hpp"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+
+namespace {
+    static constexpr uint16_t Cores = 8;
+
+    TraceSnapshot sample(uint32_t n) {
+        TraceSnapshot s {};
+        s.timestampNs = 5000000000ULL + n * 100000000ULL + (n % 3) * 1000;
+        s.packageTemperature = 60.0f + 0.37f * n;
+        s.packagePower = 95.125f - 0.5f * n;
+        s.throttleActive = n % 7 == 0;
+        s.coreCount = Cores;
+        for (uint16_t core = 0; core < Cores; core++) {
+            s.coreClock[core] = 3600.0f + 25.0f * ((n + core) % 5);
+            s.corePower[core] = 1.5f + 0.013f * core + 0.001f * n;
+            s.coreTemperature[core] = 55.0f + core + 0.25f * n;
+        }
+        return s;
+    }
+
+    /**
+     *  Encodes count snapshots, blockSamples per block, and returns the byte offset of every block.
+     */
+    std::vector<uint8_t> encode(uint32_t count, uint16_t blockSamples, std::vector<size_t> *blocks = nullptr) {
+        std::unique_ptr<TraceEncoder> encoder(new TraceEncoder());
+        encoder->configure(Cores, blockSamples);
+
+        std::vector<uint8_t> trace;
+        std::vector<uint8_t> block(TraceFormat::maxBlockSize(Cores, blockSamples));
+        auto flush = [&]() {
+            size_t size = encoder->flush(block.data(), block.size());
+            if (size && blocks)
+                blocks->push_back(trace.size());
+            trace.insert(trace.end(), block.begin(), block.begin() + size);
+        };
+
+        for (uint32_t n = 0; n < count; n++) {
+            TraceSnapshot s = sample(n);
+            if (n == 4)
+                s.coreTemperature[3] = NAN;
+            if (encoder->append(s))
+                flush();
+        }
+        flush();
+        return trace;
+    }
+
+    bool sameSnapshot(const TraceSnapshot &a, const TraceSnapshot &b) {
+        bool same = a.timestampNs / 1000 == b.timestampNs / 1000 && a.coreCount == b.coreCount &&
+                    a.throttleActive == b.throttleActive &&
+                    fabsf(a.packageTemperature - b.packageTemperature) <= 0.005f &&
+                    fabsf(a.packagePower - b.packagePower) <= 0.0005f;
+        for (uint16_t core = 0; same && core < a.coreCount; core++) {
+            same = a.coreClock[core] == b.coreClock[core] &&
+                   fabsf(a.corePower[core] - b.corePower[core]) <= 0.0005f &&
+                   (std::isnan(a.coreTemperature[core]) ? std::isnan(b.coreTemperature[core])
+                                                        : fabsf(a.coreTemperature[core] - b.coreTemperature[core]) <= 0.005f);
+        }
+        return same;
+    }
+}
+
+
+TEST_CASE(roundTripWithinQuantisation) {
+    std::vector<size_t> blocks;
+    std::vector<uint8_t> trace = encode(32, 16, &blocks);
+    CHECK_EQ(blocks.size(), 2u);
+
+    std::unique_ptr<TraceDecoder> decoder(new TraceDecoder());
+    TraceSnapshot out {};
+    size_t offset = 0;
+    uint32_t n = 0;
+    while (offset < trace.size()) {
+        size_t consumed = 0;
+        CHECK_EQ(decoder->decode(trace.data() + offset, trace.size() - offset, &consumed), TraceDecoder::OK);
+        if (!consumed)
+            break;
+        for (uint16_t i = 0; i < decoder->sampleCount(); i++, n++) {
+            decoder->snapshot(i, out);
+            TraceSnapshot expected = sample(n);
+            if (n == 4)
+                expected.coreTemperature[3] = NAN;
+            CHECK(sameSnapshot(out, expected));
+        }
+        offset += consumed;
+    }
+    CHECK_EQ(n, 32u);
+}
+
+TEST_CASE(nanIsStoredAsMissing) {
+    std::vector<uint8_t> trace = encode(8, 8);
+
+    std::unique_ptr<TraceDecoder> decoder(new TraceDecoder());
+    size_t consumed = 0;
+    CHECK_EQ(decoder->decode(trace.data(), trace.size(), &consumed), TraceDecoder::OK);
+
+    TraceSnapshot out {};
+    decoder->snapshot(4, out);
+    CHECK(std::isnan(out.coreTemperature[3]));
+    CHECK(!std::isnan(out.coreTemperature[2]));
+
+    // Neighbours of the gap keep their values, the delta chain is not broken.
+    decoder->snapshot(5, out);
+    CHECK_NEAR(out.coreTemperature[3], 55.0 + 3 + 0.25 * 5, 0.005);
+}
+
+TEST_CASE(partialLastBlockKeepsItsSampleCount) {
+    std::vector<size_t> blocks;
+    std::vector<uint8_t> trace = encode(21, 8, &blocks);
+    CHECK_EQ(blocks.size(), 3u);
+
+    std::unique_ptr<TraceDecoder> decoder(new TraceDecoder());
+    size_t consumed = 0;
+    CHECK_EQ(decoder->decode(trace.data() + blocks[2], trace.size() - blocks[2], &consumed), TraceDecoder::OK);
+    CHECK_EQ(decoder->sampleCount(), 5u);
+    CHECK_EQ(decoder->blockSequence(), 2u);
+    CHECK_EQ(blocks[2] + consumed, trace.size());
+
+    TraceSnapshot out {};
+    decoder->snapshot(4, out);
+    CHECK(sameSnapshot(out, sample(20)));
+
+    // Cut short, as when a recording is killed mid write.
+    CHECK_EQ(decoder->decode(trace.data() + blocks[2], trace.size() - blocks[2] - 1, &consumed), TraceDecoder::NeedMoreData);
+}
+
+TEST_CASE(droppedBlockShowsAsSequenceGap) {
+    std::vector<size_t> blocks;
+    std::vector<uint8_t> trace = encode(24, 8, &blocks);
+
+    // The consumer missed block 1, as when the user client queue overflows.
+    std::vector<uint8_t> lossy(trace.begin(), trace.begin() + blocks[1]);
+    lossy.insert(lossy.end(), trace.begin() + blocks[2], trace.end());
+
+    std::unique_ptr<TraceDecoder> decoder(new TraceDecoder());
+    size_t consumed = 0;
+    CHECK_EQ(decoder->decode(lossy.data(), lossy.size(), &consumed), TraceDecoder::OK);
+    CHECK_EQ(decoder->blockSequence(), 0u);
+    CHECK_EQ(decoder->decode(lossy.data() + consumed, lossy.size() - consumed, &consumed), TraceDecoder::OK);
+    CHECK_EQ(decoder->blockSequence(), 2u);
+
+    // Every block is a keyframe, the one after the gap decodes on its own.
+    TraceSnapshot out {};
+    decoder->snapshot(0, out);
+    CHECK(sameSnapshot(out, sample(16)));
+}
+
+TEST_CASE(findBlockResynchronisesAfterCorruption) {
+    std::vector<size_t> blocks;
+    std::vector<uint8_t> trace = encode(24, 8, &blocks);
+
+    // Garbage in front of the first block and an unterminated varint run inside the second.
+    std::vector<uint8_t> damaged = {0x00, 0x53, 0x50, 0x54, 0x11, 0x42};
+    size_t prefix = damaged.size();
+    damaged.insert(damaged.end(), trace.begin(), trace.end());
+    for (size_t i = 0; i < 16; i++)
+        damaged[prefix + blocks[1] + TraceFormat::HeaderSize + 4 + i] = 0xFF;
+
+    std::unique_ptr<TraceDecoder> decoder(new TraceDecoder());
+    size_t consumed = 0;
+    CHECK_EQ(decoder->decode(damaged.data(), damaged.size(), &consumed), TraceDecoder::BadMagic);
+    CHECK_EQ(TraceFormat::findBlock(damaged.data(), damaged.size()), prefix);
+
+    size_t offset = prefix;
+    CHECK_EQ(decoder->decode(damaged.data() + offset, damaged.size() - offset, &consumed), TraceDecoder::OK);
+    offset += consumed;
+    CHECK_EQ(offset, prefix + blocks[1]);
+
+    CHECK_EQ(decoder->decode(damaged.data() + offset, damaged.size() - offset, &consumed), TraceDecoder::Corrupt);
+    offset += 1 + TraceFormat::findBlock(damaged.data() + offset + 1, damaged.size() - offset - 1);
+    CHECK_EQ(offset, prefix + blocks[2]);
+
+    CHECK_EQ(decoder->decode(damaged.data() + offset, damaged.size() - offset, &consumed), TraceDecoder::OK);
+    CHECK_EQ(decoder->blockSequence(), 2u);
+
+    // Nothing after the last block.
+    CHECK_EQ(TraceFormat::findBlock(damaged.data() + offset + 1, damaged.size() - offset - 1), damaged.size() - offset - 1);
+}
+
+TEST_MAIN()
@@ -0,0 +1,385 @@
+//
+//  smctrace.cpp
+//  SMCProcessorAMD
+//
+//  Host side of the binary trace: record blocks from the user client (macOS only),
+//  decode a trace to CSV, generate a synthetic trace, and measure encode throughput
+//  and compression on a trace.
+//
+//  Built by the top level CMakeLists.txt, or by hand (add -framework IOKit on macOS):
+//      c++ -std=c++14 -O2 -I../../SMCProcessorAMD smctrace.cpp ../../SMCProcessorAMD/TraceFormat.cpp -o smctrace
+//
+
+#include "TraceFormat.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#ifdef __APPLE__
+#include <IOKit/IOKitLib.h>
+#include <IOKit/IODataQueueClient.h>
+#include <unistd.h>
+#endif
+
+
+static bool readFile(const char *path, std::vector<uint8_t> &data) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+
+    uint8_t chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        data.insert(data.end(), chunk, chunk + n);
+
+    fclose(f);
+    return true;
+}
+
+/**
+ *  Calls fn for every snapshot in the trace, skipping damaged blocks.
+ */
+template <typename Fn>
+static bool forEachSnapshot(const std::vector<uint8_t> &data, uint16_t *blockSamples, Fn fn) {
+    std::unique_ptr<TraceDecoder> decoder(new TraceDecoder());
+    std::unique_ptr<TraceSnapshot> snapshot(new TraceSnapshot());
+
+    size_t offset = 0;
+    uint32_t expected = 0;
+    bool first = true;
+
+    while (offset < data.size()) {
+        size_t consumed = 0;
+        TraceDecoder::Status status = decoder->decode(data.data() + offset, data.size() - offset, &consumed);
+
+        if (status == TraceDecoder::NeedMoreData) {
+            fprintf(stderr, "warning: %s at offset %zu, stopping\n", TraceDecoder::statusName(status), offset);
+            break;
+        }
+
+        if (status != TraceDecoder::OK) {
+            fprintf(stderr, "warning: %s at offset %zu, resynchronising\n", TraceDecoder::statusName(status), offset);
+            size_t next = TraceFormat::findBlock(data.data() + offset + 1, data.size() - offset - 1);
+            offset += 1 + next;
+            continue;
+        }
+
+        if (!first && decoder->blockSequence() != expected)
+            fprintf(stderr, "warning: blocks %u..%u missing\n", expected, decoder->blockSequence() - 1);
+        expected = decoder->blockSequence() + 1;
+
+        if (first && blockSamples)
+            *blockSamples = decoder->sampleCount();
+        first = false;
+
+        for (uint16_t n = 0; n < decoder->sampleCount(); n++) {
+            decoder->snapshot(n, *snapshot);
+            fn(*snapshot);
+        }
+
+        offset += consumed;
+    }
+
+    return !first;
+}
+
+static int writeCsv(const char *input, const char *output) {
+    std::vector<uint8_t> data;
+    if (!readFile(input, data))
+        return 1;
+
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!out) {
+        perror(output);
+        return 1;
+    }
+
+    uint16_t headerCores = 0;
+    bool any = forEachSnapshot(data, nullptr, [&](const TraceSnapshot &s) {
+        if (s.coreCount != headerCores) {
+            headerCores = s.coreCount;
+            fprintf(out, "timestamp_ns,package_temperature,package_power,throttle");
+            for (uint16_t core = 0; core < headerCores; core++)
+                fprintf(out, ",clock%u", core);
+            for (uint16_t core = 0; core < headerCores; core++)
+                fprintf(out, ",power%u", core);
+            for (uint16_t core = 0; core < headerCores; core++)
+                fprintf(out, ",temperature%u", core);
+            fprintf(out, "\n");
+        }
+
+        fprintf(out, "%llu,%.2f,%.3f,%u", (unsigned long long)s.timestampNs,
+                s.packageTemperature, s.packagePower, s.throttleActive);
+        for (uint16_t core = 0; core < s.coreCount; core++)
+            fprintf(out, ",%.0f", s.coreClock[core]);
+        for (uint16_t core = 0; core < s.coreCount; core++)
+            fprintf(out, ",%.3f", s.corePower[core]);
+        for (uint16_t core = 0; core < s.coreCount; core++)
+            fprintf(out, ",%.2f", s.coreTemperature[core]);
+        fprintf(out, "\n");
+    });
+
+    if (out != stdout)
+        fclose(out);
+
+    if (!any) {
+        fprintf(stderr, "%s: no valid block\n", input);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ *  Re-encodes the snapshots of a recorded trace and reports throughput and
+ *  size against a plain struct-per-sample log of the same fields.
+ */
+static int bench(const char *input, unsigned iterations) {
+    if (iterations == 0)
+        iterations = 1;
+
+    std::vector<uint8_t> data;
+    if (!readFile(input, data))
+        return 1;
+
+    uint16_t blockSamples = 0;
+    std::vector<TraceSnapshot> snapshots;
+    forEachSnapshot(data, &blockSamples, [&](const TraceSnapshot &s) {
+        snapshots.push_back(s);
+    });
+
+    if (snapshots.empty()) {
+        fprintf(stderr, "%s: no valid block\n", input);
+        return 1;
+    }
+
+    uint16_t cores = snapshots[0].coreCount;
+    std::unique_ptr<TraceEncoder> encoder(new TraceEncoder());
+    if (!encoder->configure(cores, blockSamples)) {
+        fprintf(stderr, "%s: unsupported geometry %u cores x %u samples\n", input, cores, blockSamples);
+        return 1;
+    }
+
+    std::vector<uint8_t> block(TraceFormat::maxBlockSize(cores, blockSamples));
+    size_t encoded = 0;
+
+    auto begin = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < iterations; i++) {
+        encoded = 0;
+        for (const TraceSnapshot &s : snapshots) {
+            if (encoder->append(s))
+                encoded += encoder->flush(block.data(), block.size());
+        }
+        encoded += encoder->flush(block.data(), block.size());
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - begin).count();
+    size_t raw = snapshots.size() * (sizeof(uint64_t) + 2 * sizeof(float) + 1 + 3 * sizeof(float) * (size_t)cores);
+    double samplesPerSecond = (double)snapshots.size() * iterations / seconds;
+
+    printf("snapshots:      %zu (%u cores, %u per block)\n", snapshots.size(), cores, blockSamples);
+    printf("raw size:       %zu bytes\n", raw);
+    printf("encoded size:   %zu bytes (%.2f bytes/snapshot)\n", encoded, (double)encoded / snapshots.size());
+    printf("ratio:          %.2fx\n", (double)raw / encoded);
+    printf("encode:         %.0f snapshots/s, %.1f MB/s raw\n", samplesPerSecond,
+           samplesPerSecond * raw / snapshots.size() / 1e6);
+    return 0;
+}
+
+/**
+ *  Writes a deterministic trace shaped like a 1 Hz recording of a loaded many-core part:
+ *  load phases that move clocks, power and temperature together, per-core noise,
+ *  short throttle episodes and one core that never reports a temperature.
+ */
+static int generate(const char *output, uint16_t cores, unsigned seconds, uint16_t blockSamples) {
+    std::unique_ptr<TraceEncoder> encoder(new TraceEncoder());
+    if (!encoder->configure(cores, blockSamples)) {
+        fprintf(stderr, "unsupported geometry %u cores x %u samples\n", cores, blockSamples);
+        return 1;
+    }
+
+    FILE *out = fopen(output, "wb");
+    if (!out) {
+        perror(output);
+        return 1;
+    }
+
+    uint32_t seed = 0x5eed;
+    auto noise = [&seed](float range) {
+        seed = seed * 1664525u + 1013904223u;
+        return ((float)(seed >> 8) / (float)(1u << 24) - 0.5f) * range;
+    };
+
+    std::unique_ptr<TraceSnapshot> s(new TraceSnapshot());
+    std::vector<uint8_t> block(TraceFormat::maxBlockSize(cores, blockSamples));
+    s->coreCount = cores;
+
+    for (unsigned t = 0; t < seconds; t++) {
+        // Alternating idle and all-core load every few minutes, with a slow thermal lag.
+        float load = ((t / 180) % 2) ? 0.9f : 0.1f;
+        float heat = 0.5f + 0.5f * tanhf(((float)(t % 180) - 30.0f) / 30.0f);
+        float level = (t / 180) % 2 ? heat : 1.0f - heat;
+
+        // Timer wakeups drift by a few microseconds.
+        s->timestampNs = 1000000000ULL * (t + 1) + (uint64_t)(noise(20.0f) + 10.0f) * 1000;
+        s->throttleActive = level > 0.95f && (t % 60) < 3;
+        s->packageTemperature = 40.0f + 45.0f * level + noise(0.5f);
+        s->packagePower = 35.0f + 180.0f * load * (0.8f + 0.2f * level) + noise(4.0f);
+
+        for (uint16_t core = 0; core < cores; core++) {
+            bool busy = noise(1.0f) + 0.5f < load;
+            s->coreClock[core] = busy ? 3400.0f + 25.0f * (int)(noise(16.0f) + 8.0f) : 2200.0f;
+            s->corePower[core] = busy ? 2.5f + noise(1.0f) : 0.15f + noise(0.1f);
+            s->coreTemperature[core] = core == 5 ? NAN : s->packageTemperature - 4.0f + noise(3.0f);
+        }
+
+        if (encoder->append(*s))
+            fwrite(block.data(), 1, encoder->flush(block.data(), block.size()), out);
+    }
+
+    // The remainder goes out as a partial block, as when a recording is stopped.
+    size_t tail = encoder->flush(block.data(), block.size());
+    fwrite(block.data(), 1, tail, out);
+
+    fclose(out);
+    return 0;
+}
+
+#ifdef __APPLE__
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int) {
+    stopRequested = 1;
+}
+
+/**
+ *  User client selectors and memory type, see SMCProcessorAMDUserClient.
+ */
+enum : uint32_t {
+    kStartTrace = 9,
+    kStopTrace = 10,
+    kTraceQueue = 1,
+};
+
+static void drain(IODataQueueMemory *queue, FILE *out, std::vector<uint8_t> &buffer) {
+    while (IODataQueueDataAvailable(queue)) {
+        uint32_t size = (uint32_t)buffer.size();
+        if (IODataQueueDequeue(queue, buffer.data(), &size) != kIOReturnSuccess)
+            break;
+        fwrite(buffer.data(), 1, size, out);
+    }
+    fflush(out);
+}
+
+static int record(const char *output, uint16_t blockSamples) {
+    io_service_t service = IOServiceGetMatchingService(kIOMasterPortDefault, IOServiceMatching("SMCProcessorAMD"));
+    if (!service) {
+        fprintf(stderr, "SMCProcessorAMD not loaded\n");
+        return 1;
+    }
+
+    io_connect_t connect = 0;
+    kern_return_t kr = IOServiceOpen(service, mach_task_self(), 0, &connect);
+    IOObjectRelease(service);
+    if (kr != KERN_SUCCESS) {
+        fprintf(stderr, "IOServiceOpen failed: 0x%x\n", kr);
+        return 1;
+    }
+
+    uint64_t in = blockSamples;
+    uint64_t cores = 0;
+    uint32_t outCount = 1;
+    kr = IOConnectCallScalarMethod(connect, kStartTrace, &in, 1, &cores, &outCount);
+    if (kr != KERN_SUCCESS) {
+        fprintf(stderr, "start trace failed: 0x%x\n", kr);
+        IOServiceClose(connect);
+        return 1;
+    }
+
+    mach_vm_address_t address = 0;
+    mach_vm_size_t size = 0;
+    kr = IOConnectMapMemory64(connect, kTraceQueue, mach_task_self(), &address, &size, kIOMapAnywhere);
+    if (kr != KERN_SUCCESS) {
+        fprintf(stderr, "mapping trace queue failed: 0x%x\n", kr);
+        IOConnectCallScalarMethod(connect, kStopTrace, nullptr, 0, nullptr, nullptr);
+        IOServiceClose(connect);
+        return 1;
+    }
+
+    FILE *out = fopen(output, "wb");
+    if (!out) {
+        perror(output);
+        IOConnectCallScalarMethod(connect, kStopTrace, nullptr, 0, nullptr, nullptr);
+        IOServiceClose(connect);
+        return 1;
+    }
+
+    fprintf(stderr, "recording %llu cores to %s, ^C to stop\n", (unsigned long long)cores, output);
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    auto queue = reinterpret_cast<IODataQueueMemory *>(address);
+    std::vector<uint8_t> buffer(TraceFormat::maxBlockSize(TraceSnapshot::MaxCores, TraceFormat::MaxBlockSamples));
+
+    // Blocks arrive at most once per sampling period, polling keeps ^C handling simple.
+    while (!stopRequested) {
+        drain(queue, out, buffer);
+        usleep(100000);
+    }
+
+    // Stopping flushes the partial block into the queue.
+    IOConnectCallScalarMethod(connect, kStopTrace, nullptr, 0, nullptr, nullptr);
+    drain(queue, out, buffer);
+
+    fclose(out);
+    IOConnectUnmapMemory64(connect, kTraceQueue, mach_task_self(), address);
+    IOServiceClose(connect);
+    return 0;
+}
+#endif
+
+static void usage() {
+    fprintf(stderr,
+            "usage: smctrace csv <trace> [out.csv]\n"
+            "       smctrace bench <trace> [iterations]\n"
+            "       smctrace generate <trace> [cores] [seconds] [samples per block]\n"
+#ifdef __APPLE__
+            "       smctrace record <trace> [samples per block]\n"
+#endif
+            );
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        usage();
+        return 1;
+    }
+
+    if (!strcmp(argv[1], "csv"))
+        return writeCsv(argv[2], argc > 3 ? argv[3] : nullptr);
+
+    if (!strcmp(argv[1], "bench"))
+        return bench(argv[2], argc > 3 ? (unsigned)strtoul(argv[3], nullptr, 0) : 100);
+
+    if (!strcmp(argv[1], "generate"))
+        return generate(argv[2],
+                        argc > 3 ? (uint16_t)strtoul(argv[3], nullptr, 0) : 64,
+                        argc > 4 ? (unsigned)strtoul(argv[4], nullptr, 0) : 3600,
+                        argc > 5 ? (uint16_t)strtoul(argv[5], nullptr, 0) : 60);
+
+#ifdef __APPLE__
+    if (!strcmp(argv[1], "record"))
+        return record(argv[2], argc > 3 ? (uint16_t)strtoul(argv[3], nullptr, 0) : 60);
+#endif
+
+    usage();
+    return 1;
+}